@@ -114,6 +114,20 @@
 #define BULL_SLEEP 60000
 #define FROG_BULL_SLEEP 500000
 
+//indice delle impronte
+#define N_IMPRONTE 1024 //slot della tabella hash pid -> rettangolo (potenza di 2)
+//Flag di build: -DIMPRONTE_CHECK=1 rifà a ogni delete_old() la scansione completa della matrice
+//e conta le celle del pid rimaste fuori dall'impronta (stampate su stderr a fine manche)
+#ifndef IMPRONTE_CHECK
+#define IMPRONTE_CHECK 0
+#endif
+#define N_PROIETTILI 256 //slot della tabella hash pid -> posizione dei proiettili della rana (potenza di 2)
+
+//benchmark dei proiettili (--bench=proiettili)
+#define BENCH_PASSI 40 //passi in una direzione prima di invertire la velocità
+#define BENCH_GIRI 200 //andate e ritorni per misura
+#define BENCH_PID 0x1000000 //pid finti oltre pid_max, così kill() non può colpire processi veri
+
 
 //finestra di gioco
 WINDOW *gamewin;
@@ -144,6 +158,22 @@ struct game {
    bool loss;
 };
 
+//rettangolo di celle che un pid ha timbrato nella matrice dall'ultima cancellazione
+struct impronta {
+   pid_t pid; //0 = slot libero
+   int x0;    //colonna iniziale (inclusa)
+   int y0;    //riga iniziale (inclusa)
+   int x1;    //colonna finale (esclusa)
+   int y1;    //riga finale (esclusa)
+};
+
+//cella in cui sta un proiettile della rana, tenuta accanto alla matrice
+struct proiettile {
+   pid_t pid; //0 = slot libero
+   int x;
+   int y;
+};
+
 
 //firme delle funzioni
 struct point get_screen_size();
@@ -187,6 +217,20 @@ bool frog_collision(int, int);
 bool bullet_is_out_of_bounds(int);
 void update_frog(int, int, pid_t);
 void delete_old(pid_t, bool);
+void cancella_cella(size_t, size_t, pid_t, bool);
+unsigned hash_pid(pid_t);
+int slot_impronta(pid_t);
+void registra_impronta(pid_t, int, int, int, int);
+void togli_impronta(int);
+void ready_impronte();
+int slot_proiettile(pid_t);
+void registra_proiettile(pid_t, int, int);
+void togli_proiettile(pid_t);
+bool trova_proiettile(pid_t, int, int*);
+void timbra_proiettile(pid_t, int, int);
+void ready_proiettili();
+int bench_proiettili();
+double bench_run(int, bool);
 void update_matrix_croc_bull(struct msg);
 void update_matrix_bull(struct msg);
 void update_matrix_croc(struct msg);
@@ -215,6 +259,19 @@ struct point frogxy;
 //matrice di gioco
 struct msg game_matrix[DIM_X+2*CROC_X][DIM_Y];
 struct game partita;
+//indice delle impronte (tabella hash ad indirizzamento aperto sul pid)
+struct impronta impronte[N_IMPRONTE];
+int n_impronte;
+//false se la tabella si è riempita: delete_old() torna alla scansione completa fino alla prossima manche
+bool impronte_complete;
+#if IMPRONTE_CHECK
+long long stat_impronte_mismatch = 0; //celle trovate dalla scansione completa fuori dall'impronta
+#endif
+//posizioni dei proiettili della rana (tabella hash ad indirizzamento aperto sul pid)
+struct proiettile proiettili[N_PROIETTILI];
+int n_proiettili;
+//false solo nel benchmark, per misurare la vecchia ricerca lungo la riga
+bool cache_proiettili = true;
 
 //sprite
 
@@ -237,7 +294,12 @@ char tana_aperta[TANA_Y*TANA_X][TANA_X]={"◢","█","█","█","█","◣",
 
 //char tana_chiusa
 
-int main() {
+int main(int argc, char** argv) {
+   for (int i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "--bench=proiettili") == 0) {return bench_proiettili();}
+      fprintf(stderr, "uso: %s [--bench=proiettili]\n", argv[0]);
+      return 2;
+   }
    //funzione che si occupa di inizializzare la schermata e i colori
    game_init();
    //funzione che contiene la logica di gioco
@@ -352,6 +414,9 @@ void manche() {
    }
    
    kill_all();
+#if IMPRONTE_CHECK
+   fprintf(stderr, "impronte: celle fuori impronta=%lld\n", stat_impronte_mismatch);
+#endif
 }
 
    
@@ -422,6 +487,7 @@ void update_matrix_croc(struct msg temp) {
    if (croc_is_out_of_bounds(temp)) {kill_process(temp.pid);}
    //if ((frog_on_water()) || frog_is_out_of_bounds()) {kill_process(frogxy.pid); partita.manche_on = false; partita.loss = true;}
    else {
+      registra_impronta(temp.pid, temp.x, temp.y, CROC_X, CROC_Y);
       for(size_t i = 0; i < CROC_X; i++) {
          for(size_t j = 0; j < CROC_Y; j++) {
            if (/*game_matrix[temp.x+i][temp.y+j].id != FROG_ID &&*/ game_matrix[temp.x+i][temp.y+j].id != BULL_ID) {
@@ -447,58 +513,90 @@ void update_matrix_croc(struct msg temp) {
 
 //funzione che aggiorna la matrice relativamente ai proiettili
 void update_matrix_bull(struct msg temp) {
+   int x;
    if (temp.first) {
-      //for (int i = frogxy.x+abs(temp.x); i < frogxy.x + abs(temp.x) + BULL_X; i++) {
-      /*
-         for (int j = temp.y-1; j < temp.y + BULL_Y; j++) {
-            game_matrix[i][j].id = BULL_ID;
-            game_matrix[i][j].pid = temp.pid;
-            strcpy(game_matrix[i][j].ch, SYMB_BULL);
-             
-         }
-         */
-         if (temp.x_speed > 0) {
-            game_matrix[frogxy.x+FROG_X][temp.y].id = BULL_ID;
-            game_matrix[frogxy.x+FROG_X][temp.y].pid = temp.pid;
-            strcpy(game_matrix[frogxy.x+FROG_X][temp.y].ch, SYMB_BULL);
-            }
-         else {
-            game_matrix[frogxy.x-1][temp.y].id = BULL_ID;
-            game_matrix[frogxy.x-1][temp.y].pid = temp.pid;
-            strcpy(game_matrix[frogxy.x-1][temp.y].ch, SYMB_BULL);
-         
-         }
-      //}
+      //la y arriva dalla copia di frogxy del processo rana, che può essere uscita dal campo
+      if (temp.y < 0 || temp.y >= DIM_Y) {kill_process(temp.pid);}
+      else if (temp.x_speed > 0) {timbra_proiettile(temp.pid, frogxy.x+FROG_X, temp.y);}
+      else {timbra_proiettile(temp.pid, frogxy.x-1, temp.y);}
    }
-   
-   else {
-   
-      for (int i = 0; i < CROC_X*2+DIM_X; i++) {
-          if (game_matrix[i][temp.y].pid == temp.pid) {
-             //beep();
-             delete_old(temp.pid, false);
-             if (bullet_is_out_of_bounds(i+temp.x_speed)) {kill_process(temp.pid);}
-             else {
-             /*
-             for (int j = i+abs(temp.x)+1; j <  i+abs(temp.x)+1+ BULL_X; j++) {
-               for (int h = temp.y; h < temp.y + BULL_Y; h++) {
-                  game_matrix[j][h].pid = temp.pid;
-                  game_matrix[j][h].id = BULL_ID;
-                  strcpy(game_matrix[j][h].ch, SYMB_BULL);
-                }
-       }*/   
-            game_matrix[i+temp.x_speed][temp.y].id = BULL_ID;
-            game_matrix[i+temp.x_speed][temp.y].pid = temp.pid;
-            strcpy(game_matrix[i+temp.x_speed][temp.y].ch, SYMB_BULL);
-            i = CROC_X*2+DIM_X;
-            }
-     }
+   else if (trova_proiettile(temp.pid, temp.y, &x)) {
+      delete_old(temp.pid, false);
+      if (bullet_is_out_of_bounds(x+temp.x_speed)) {kill_process(temp.pid); togli_proiettile(temp.pid);}
+      else {timbra_proiettile(temp.pid, x+temp.x_speed, temp.y);}
    }
-   
-   
-   
- }
- 
+}
+
+//funzione che scrive il proiettile nella cella (x, y) e ne aggiorna la posizione
+void timbra_proiettile(pid_t pid, int x, int y) {
+   game_matrix[x][y].id = BULL_ID;
+   game_matrix[x][y].pid = pid;
+   strcpy(game_matrix[x][y].ch, SYMB_BULL);
+   registra_impronta(pid, x, y, 1, 1);
+   registra_proiettile(pid, x, y);
+}
+
+//funzione che mette in *x la colonna del proiettile sulla riga y; false se il proiettile non è più nella matrice
+bool trova_proiettile(pid_t pid, int y, int* x) {
+   if (y < 0 || y >= DIM_Y) {return false;}
+   int s = slot_proiettile(pid);
+   if (cache_proiettili && proiettili[s].pid == pid) {
+      //solo i proiettili della rana scrivono il loro pid, quindi se la cella è stata sovrascritta il proiettile non c'è più
+      if (proiettili[s].y == y && game_matrix[proiettili[s].x][y].pid == pid) {*x = proiettili[s].x; return true;}
+      togli_proiettile(pid);
+      return false;
+   }
+   //niente posizione (tabella piena o benchmark): cerco il pid lungo la riga
+   for (int i = 0; i < CROC_X*2+DIM_X; i++) {
+      if (game_matrix[i][y].pid == pid) {*x = i; return true;}
+   }
+   return false;
+}
+
+//funzione che ritorna lo slot del proiettile nella tabella, o lo slot libero in cui andrebbe inserito
+int slot_proiettile(pid_t pid) {
+   int s = hash_pid(pid) & (N_PROIETTILI-1);
+   while (proiettili[s].pid != 0 && proiettili[s].pid != pid) {s = (s+1) & (N_PROIETTILI-1);}
+   return s;
+}
+
+//funzione che salva la posizione del proiettile
+void registra_proiettile(pid_t pid, int x, int y) {
+   if (pid <= 0 || !cache_proiettili) {return;}
+   int s = slot_proiettile(pid);
+   if (proiettili[s].pid == 0) {
+      //oltre metà tabella il proiettile resta senza posizione e viene cercato lungo la riga
+      if (n_proiettili >= N_PROIETTILI/2) {return;}
+      proiettili[s].pid = pid;
+      n_proiettili++;
+   }
+   proiettili[s].x = x;
+   proiettili[s].y = y;
+}
+
+//funzione che dimentica la posizione del proiettile (stessa cancellazione di togli_impronta)
+void togli_proiettile(pid_t pid) {
+   int s = slot_proiettile(pid);
+   if (proiettili[s].pid != pid) {return;}
+   int i = s;
+   proiettili[s].pid = 0;
+   n_proiettili--;
+   while (true) {
+      i = (i+1) & (N_PROIETTILI-1);
+      if (proiettili[i].pid == 0) {return;}
+      int casa = hash_pid(proiettili[i].pid) & (N_PROIETTILI-1);
+      if (((i - casa) & (N_PROIETTILI-1)) >= ((i - s) & (N_PROIETTILI-1))) {
+         proiettili[s] = proiettili[i];
+         proiettili[i].pid = 0;
+         s = i;
+      }
+   }
+}
+
+//funzione che svuota la tabella dei proiettili
+void ready_proiettili() {
+   memset(proiettili, 0, sizeof(proiettili));
+   n_proiettili = 0;
 }
 
 //funzione che aggiorna la matrice relativamente ai proiettili coccodrillo
@@ -507,9 +605,12 @@ void update_matrix_croc_bull(struct msg temp) {
    if (bullet_is_out_of_bounds(temp.x)) {kill_process(temp.pid);}
    else {
    if (game_matrix[temp.x][temp.y].id == BULL_ID && game_matrix[temp.x][temp.y].pid > 0) {
+      pid_t colpito = game_matrix[temp.x][temp.y].pid;
       kill_process(temp.pid);
-      kill_process(game_matrix[temp.x][temp.y].pid);
-      delete_old(game_matrix[temp.x][temp.y].pid, false);
+      kill_process(colpito);
+      delete_old(colpito, false);
+      //i messaggi già in pipe del proiettile colpito non devono trovarlo più
+      togli_proiettile(colpito);
    }
    else if (frog_collision(temp.x, temp.y)) {
       kill_process(frogxy.pid);
@@ -520,6 +621,7 @@ void update_matrix_croc_bull(struct msg temp) {
    else{
    game_matrix[temp.x][temp.y].id = BULL_CROC_ID;
    game_matrix[temp.x][temp.y].pid = temp.pid;
+   registra_impronta(temp.pid, temp.x, temp.y, 1, 1);
 
    wattron(gamewin, COLOR_PAIR(COL_TANE));
    if (temp.x_speed > 0) {strcpy(game_matrix[temp.x][temp.y].ch, RIGHT_BULL);}
@@ -554,6 +656,7 @@ void update_frog(int x, int y, pid_t pid) {
 void update_matrix_frog(bool need) {
    delete_old(frogxy.pid, true);
    //check_frog_win();
+   registra_impronta(frogxy.pid, frogxy.x, frogxy.y, FROG_X, FROG_Y);
    for(size_t i = 0; i < FROG_X; i++) {
       for(size_t j = 0; j < FROG_Y; j++) {
          if (game_matrix[frogxy.x+i][frogxy.y+j].id != BULL_ID) {
@@ -569,28 +672,105 @@ void update_matrix_frog(bool need) {
 }
 
 //funzione che cancella le vecchie entità
+//scorre solo l'impronta del pid; la scansione completa resta per pid non validi o se l'indice è incompleto
 void delete_old(pid_t pid, bool frog) {
+   int x0 = 0, y0 = 0, x1 = DIM_X + CROC_X*2, y1 = DIM_Y;
+   int s = -1;
+   if (pid > 0) {
+      s = slot_impronta(pid);
+      if (impronte[s].pid != pid) {s = -1;}
+      if (impronte_complete) {
+         //se il pid non ha impronta non ha celle da cancellare
+         if (s < 0) {x1 = x0;}
+         else {x0 = impronte[s].x0; y0 = impronte[s].y0; x1 = impronte[s].x1; y1 = impronte[s].y1;}
+      }
+   }
+   for(int i = x0; i < x1; i++) {
+      for(int j = y0; j < y1; j++) {
+         cancella_cella(i, j, pid, frog);
+      }
+   }
+   if (s >= 0) {togli_impronta(s);}
+#if IMPRONTE_CHECK
+   //confronto con la scansione completa: ogni cella rimasta è un'impronta sbagliata
    for(size_t i = 0; i < DIM_X + CROC_X*2; i++) {
       for(size_t j = 0; j < DIM_Y; j++) {
-         if (pid == game_matrix[i][j].pid) {
-            if (frog && frogxy.on_croc /*&& game_matrix[i][j].id != BULL_ID*/) {
-               game_matrix[i][j].id = CROC_ID; 
-               game_matrix[i][j].pid = -1; 
-            }
-            //else if (game_matrix[i][j].id == BULL_ID) {
-            //}
-            else if (game_matrix[i][j].id == BULL_ID) {game_matrix[i][j].id = CROC_ID; 
-               game_matrix[i][j].pid = -1; }
-            else{
-               game_matrix[i][j].pid = -1;
-               game_matrix[i][j].id = -1; 
-               
-            }
-            
-         }
+         if (pid == game_matrix[i][j].pid) {stat_impronte_mismatch++; cancella_cella(i, j, pid, frog);}
       }
-   }  
+   }
+#endif
+}
 
+//funzione che cancella la cella (i, j) se appartiene al pid
+void cancella_cella(size_t i, size_t j, pid_t pid, bool frog) {
+   if (pid == game_matrix[i][j].pid) {
+      if (frog && frogxy.on_croc /*&& game_matrix[i][j].id != BULL_ID*/) {
+         game_matrix[i][j].id = CROC_ID; 
+         game_matrix[i][j].pid = -1; 
+      }
+      else if (game_matrix[i][j].id == BULL_ID) {game_matrix[i][j].id = CROC_ID; 
+         game_matrix[i][j].pid = -1; }
+      else{
+         game_matrix[i][j].pid = -1;
+         game_matrix[i][j].id = -1; 
+      }
+   }
+}
+
+//funzione che sparpaglia i pid: quelli consecutivi finirebbero in slot vicini e allungherebbero le sonde
+unsigned hash_pid(pid_t pid) {
+   return (unsigned)pid * 2654435761u;
+}
+
+//funzione che ritorna lo slot del pid nell'indice, o lo slot libero in cui andrebbe inserito
+int slot_impronta(pid_t pid) {
+   int s = hash_pid(pid) & (N_IMPRONTE-1);
+   while (impronte[s].pid != 0 && impronte[s].pid != pid) {s = (s+1) & (N_IMPRONTE-1);}
+   return s;
+}
+
+//funzione che allarga l'impronta del pid al rettangolo w*h che parte da (x, y)
+void registra_impronta(pid_t pid, int x, int y, int w, int h) {
+   if (pid <= 0) {return;}
+   int s = slot_impronta(pid);
+   if (impronte[s].pid == 0) {
+      //la tabella resta piena al massimo a metà, così le sonde restano corte e c'è sempre uno slot libero
+      if (n_impronte >= N_IMPRONTE/2) {impronte_complete = false; return;}
+      impronte[s].pid = pid;
+      impronte[s].x0 = x; impronte[s].y0 = y; impronte[s].x1 = x+w; impronte[s].y1 = y+h;
+      n_impronte++;
+   }
+   else {
+      if (x < impronte[s].x0) {impronte[s].x0 = x;}
+      if (y < impronte[s].y0) {impronte[s].y0 = y;}
+      if (x+w > impronte[s].x1) {impronte[s].x1 = x+w;}
+      if (y+h > impronte[s].y1) {impronte[s].y1 = y+h;}
+   }
+}
+
+//funzione che libera lo slot s e riporta indietro le voci successive della stessa sequenza di sonde
+void togli_impronta(int s) {
+   int i = s;
+   impronte[s].pid = 0;
+   n_impronte--;
+   while (true) {
+      i = (i+1) & (N_IMPRONTE-1);
+      if (impronte[i].pid == 0) {return;}
+      int casa = hash_pid(impronte[i].pid) & (N_IMPRONTE-1);
+      //la voce si sposta nel buco solo se il buco sta tra il suo slot di partenza e la sua posizione
+      if (((i - casa) & (N_IMPRONTE-1)) >= ((i - s) & (N_IMPRONTE-1))) {
+         impronte[s] = impronte[i];
+         impronte[i].pid = 0;
+         s = i;
+      }
+   }
+}
+
+//funzione che svuota l'indice delle impronte
+void ready_impronte() {
+   memset(impronte, 0, sizeof(impronte));
+   n_impronte = 0;
+   impronte_complete = true;
 }
 
 //funzione che controlla se la rana ha chiuso una tana
@@ -695,6 +875,9 @@ void ready_frog() {
 
 //fuznione che setta tutte le celle della matrice a -1
 void ready_matrix() {
+   //nessun pid ha più celle nella matrice
+   ready_impronte();
+   ready_proiettili();
    //preparo la matrice con i valori iniziali corretti
    for (size_t i = 0; i < DIM_X+CROC_X*2; i++) {
       for (size_t j = 0; j < DIM_Y; j++) {
@@ -708,7 +891,7 @@ void ready_matrix() {
       for(size_t j = frogxy.x; j < frogxy.x+FROG_X; j++) {
          game_matrix[j][i].pid = -1;
          game_matrix[j][i].id = FROG_ID;
-         strcpy(game_matrix[j][i].ch, frog_sprite[j+FROG_X*i]);
+         strcpy(game_matrix[j][i].ch, frog_sprite[(j-frogxy.x)+FROG_X*(i-frogxy.y)]);
       }
    }
 }
@@ -1211,5 +1394,59 @@ void tana() {
 }
 */
 
+//--- benchmark dei proiettili (--bench=proiettili): niente ncurses né processi ---
+
+//funzione che muove n proiettili avanti e indietro lungo le righe e ritorna i secondi impiegati
+double bench_run(int n, bool cache) {
+   struct msg m = {0}; struct timespec t0, t1;
+   int per_riga = (n + DIM_Y - 1) / DIM_Y;
+   int passo = (DIM_X - BENCH_PASSI - 2) / per_riga;
+   cache_proiettili = cache;
+   ready_frog();
+   ready_matrix();
+   //ogni proiettile nasce sulla riga k % DIM_Y, distanziato dagli altri della stessa riga
+   m.id = BULL_ID; m.first = true; m.x_speed = BULL_SPEED;
+   for (int k = 0; k < n; k++) {
+      m.pid = BENCH_PID + k;
+      m.y = k % DIM_Y;
+      frogxy.x = CROC_X + 1 + (k / DIM_Y) * passo - FROG_X;
+      update_matrix_bull(m);
+   }
+   m.first = false;
+   clock_gettime(CLOCK_MONOTONIC, &t0);
+   for (int g = 0; g < BENCH_GIRI*2; g++) {
+      m.x_speed = (g % 2 == 0) ? (BULL_SPEED) : (-BULL_SPEED);
+      for (int p = 0; p < BENCH_PASSI; p++) {
+         for (int k = 0; k < n; k++) {
+            m.pid = BENCH_PID + k;
+            m.y = k % DIM_Y;
+            update_matrix_bull(m);
+         }
+      }
+   }
+   clock_gettime(CLOCK_MONOTONIC, &t1);
+   cache_proiettili = true;
+   return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
 
-
+int bench_proiettili() {
+   int n[3] = {8, 32, N_PROIETTILI/2};
+   static struct msg matrice_riga[DIM_X+2*CROC_X][DIM_Y];
+   printf("proiettili: %d spostamenti per proiettile\n", BENCH_GIRI*2*BENCH_PASSI);
+   for (int i = 0; i < 3; i++) {
+      long mosse = (long)n[i] * BENCH_GIRI*2*BENCH_PASSI;
+      double t_riga = bench_run(n[i], false);
+      memcpy(matrice_riga, game_matrix, sizeof(game_matrix));
+      double t_cache = bench_run(n[i], true);
+      //le due ricerche devono lasciare la stessa matrice
+      bool uguali = true;
+      for (size_t x = 0; x < DIM_X+CROC_X*2; x++) {
+         for (size_t y = 0; y < DIM_Y; y++) {
+            if (matrice_riga[x][y].pid != game_matrix[x][y].pid || matrice_riga[x][y].id != game_matrix[x][y].id) {uguali = false;}
+         }
+      }
+      printf("  proiettili=%3d  ricerca sulla riga %7.1f ns/mossa  posizione in cache %7.1f ns/mossa  %s\n",
+         n[i], t_riga / mosse * 1e9, t_cache / mosse * 1e9, uguali ? "matrici uguali" : "MATRICI DIVERSE");
+   }
+   return 0;
+}
@@ -18,6 +18,22 @@
 #include <errno.h>       // errno, EAGAIN, EWOULDBLOCK (gestione lettura non bloccante)
 #include <signal.h>      // kill, SIGKILL (terminazione processi)
 #include <time.h>        // usleep
+#include <sys/mman.h>    // mmap/munmap: regione condivisa per il ring buffer
+#include <sys/eventfd.h> // eventfd: risveglio del consumatore (trasporto shm)
+#include <poll.h>        // poll: attesa sull'eventfd
+#include <stdatomic.h>   // atomici C11 per il ring multi-produttore
+#include <stdint.h>      // uint64_t (contatore eventfd)
+#include <limits.h>      // INT_MIN (x precedente non ancora nota)
+#include <sys/epoll.h>   // epoll: attesa su messaggi e scadenza del frame
+#include <sys/timerfd.h> // timerfd: cadenza dei frame
+#include <sys/resource.h> // getrusage: CPU usata dal padre
+#include <sys/ioctl.h>   // ioctl FIONREAD: byte in attesa nella pipe
+#include <sys/syscall.h> // syscall(): io_uring_setup/enter/register senza liburing
+#include <linux/io_uring.h> // strutture e costanti di io_uring
+#include <sys/prctl.h>   // prctl(PR_SET_PDEATHSIG): i worker del pool muoiono col creatore
+#include <dirent.h>      // opendir/readdir su /proc (cambi di contesto dei produttori)
+#include <sys/signalfd.h> // signalfd: SIGCHLD come evento del ciclo principale
+#include <pthread.h>     // pthread_atfork: pid del produttore in cache azzerato nei figli
 
 
 
@@ -83,17 +99,76 @@ static const char *croc_sprite_left[CROC_H] = {
 #define OBJ_GRENADE      5                  // id messaggio: richiesta sparo granate
 #define OBJ_QUIT         3                  // id messaggio: richiesta uscita
 #define OBJ_TELEPORT     6                  // id messaggio: richiesta teletrasporto rana
+#define OBJ_CROC_SPAWN   7                  // id messaggio: nascita coccodrillo (dead reckoning)
+#define OBJ_CROC_DESPAWN 8                  // id messaggio: coccodrillo uscito di scena
+#define OBJ_FIRE         9                  // id messaggio: sparo di un coccodrillo (origine, direzione, istante)
+#define OBJ_PROJECTILE_GONE 10              // id messaggio: processo proiettile/granata terminato
 #define N_FLUSSI         8                  // numero di corsie del fiume
          // altezza coccodrillo (uguale alla rana)
 // Fattore di velocità globale: maggiore => più lento (moltiplica la sleep)
 #define CROC_SPEED       2
 #define CROC_SLEEP_US    120000   // base frame delay per coccodrilli
 #define CREATOR_SLEEP_US 800000   // spawna molto meno spesso
+#define CROC_TICK_US     (CROC_SLEEP_US * CROC_SPEED) // durata di un passo del coccodrillo
 #define MAX_MSGS_PER_FRAME 512     // limite di messaggi da drenare per frame per evitare starvation
 #define GRENADE_COOLDOWN_MS 500    // tempo minimo tra due spari di granata
+#define PROJECTILE_STEP_US 50000   // un proiettile avanza di una colonna ogni 50 ms
+
+// Flag di build: -DPROJECTILE_PROCESSES=1 ripristina un processo per ogni proiettile/granata
+// (richiesta del progetto). Con 0 i proiettili sono entità del padre create da un evento di sparo.
+#ifndef PROJECTILE_PROCESSES
+#define PROJECTILE_PROCESSES 0
+#endif
+
+// Flag di build: -DBITBOARD_CHECK=1 confronta a ogni frame le bitboard di collisione con
+// le query sulle corsie e conta i disaccordi nelle statistiche di sessione (per i proiettili
+// la bitboard è solo un filtro: disaccordo = colpo che il filtro avrebbe scartato)
+#ifndef BITBOARD_CHECK
+#define BITBOARD_CHECK 0
+#endif
+
+// Trasporto messaggi figli -> padre (selezionabile a runtime con --transport=)
+#define TRANSPORT_PIPE   0                  // pipe classica: una write()/read() per messaggio
+#define TRANSPORT_SHM    1                  // ring condiviso (mmap MAP_SHARED) + eventfd
+#define TRANSPORT_URING  2                  // pipe letta da io_uring (read multishot + timeout del frame)
+#define SHM_RING_CAP     4096               // celle del ring (potenza di 2)
+#define SHM_STUCK_MS     50                 // cella prenotata ma mai pubblicata: si controlla il produttore
+#define SHM_SEND_SPINS   64                 // tentativi su una cella firmata da un altro produttore
+
+// Protocollo dei coccodrilli (selezionabile a runtime con --croc-proto=)
+#define CROC_PROTO_POS   0                  // una posizione assoluta per ogni passo
+#define CROC_PROTO_DR    1                  // dead reckoning: solo nascita e uscita, x calcolata dal padre
 
 
 static int pipe_fds[2];                     // pipe: [0]=read lato padre, [1]=write lato figli
+static int input_fds[2] = { -1, -1 };       // canale riservato ai tasti della rana (drenato per primo)
+
+// Controllo di flusso dei produttori: la write-end è non bloccante, le posizioni che
+// non trovano posto vengono saltate (la successiva le sostituisce), gli eventi
+// (nascita, uscita, sparo) si ritentano finché il padre non li riceve
+#define PRODUCER_CROC        0
+#define PRODUCER_PROJECTILE  1
+#define PRODUCER_FROG        2
+#define PRODUCER_KINDS       3
+#define PRODUCER_RETRY_US    1000           // attesa tra due tentativi di un evento
+
+typedef struct {
+    atomic_llong sent;                      // messaggi consegnati al canale
+    atomic_llong dropped;                   // posizioni saltate a canale pieno
+    atomic_llong retried;                   // tentativi ripetuti per gli eventi
+} ProducerStats;
+
+// Contatori condivisi tra tutti i processi (regione MAP_SHARED creata prima del primo fork)
+typedef struct {
+    atomic_llong forks;                     // fork() riusciti in tutta la sessione
+    atomic_llong msgs_sent;                 // messaggi inviati con successo dai figli
+    ProducerStats producers[PRODUCER_KINDS]; // per tipo di produttore
+    atomic_llong spawns;                    // coccodrilli partiti
+    atomic_llong spawn_lat_sum;             // assegnazione -> primo messaggio consegnato (us)
+    atomic_llong spawn_lat_max;
+} SharedStats;
+
+static SharedStats *shared_stats = NULL;
 
 typedef struct msg{                         // messaggio inviato dai figli al padre
     int id;                                 // tipo oggetto/azione
@@ -101,8 +176,167 @@ typedef struct msg{                         // messaggio inviato dai figli al pa
     int y;                                  // coordinata y (o delta per la rana)
     int pid;                                // pid del processo mittente
     int x_speed; // velocità orizzontale (0 per rana, direzione per proiettili)
+    long long t_us; // istante monotonic (us) di inizio moto per OBJ_CROC_SPAWN
 } msg;
 
+// Ring multi-produttore / singolo consumatore in memoria condivisa (coda limitata
+// a numeri di sequenza: ogni cella dice se è libera per il giro corrente o pubblicata)
+typedef struct {
+    atomic_uint seq;                        // == pos: libera, == pos+1: pubblicata
+    atomic_int owner;                       // pid del produttore che l'ha prenotata (0 = libera)
+    msg m;                                  // messaggio trasportato
+} RingCell;
+
+typedef struct {
+    atomic_uint head;                       // prossima posizione da prenotare (produttori)
+    char pad_head[60];                      // evita false sharing tra head e tail
+    atomic_uint tail;                       // prossima posizione da leggere (solo padre)
+    atomic_int sleeping;                    // 1 se il padre aspetta sull'eventfd
+    char pad_tail[56];
+    RingCell cells[SHM_RING_CAP];
+} ShmRing;
+
+static int transport_mode = TRANSPORT_PIPE; // trasporto scelto all'avvio
+static ShmRing *shm_ring = NULL;            // regione condivisa (ereditata dai figli col fork)
+static int shm_event_fd = -1;               // eventfd di risveglio del padre
+static long long shm_stuck_since_ms = -1;   // da quando la cella in testa risulta prenotata
+static long long stat_shm_skipped = 0;      // celle saltate perché il produttore era morto
+static pid_t shm_self_pid = 0;              // pid di questo processo (0 = da leggere, dopo un fork)
+static unsigned char pipe_carry[sizeof(msg)]; // byte di un record letto a metà (coda del batch)
+static size_t pipe_carry_len = 0;           // quanti byte validi in pipe_carry
+
+// Trasporto io_uring: una read multishot resta armata sulla pipe e il kernel riempie
+// i buffer forniti (buffer ring); il padre raccoglie i completamenti dalla coda
+// condivisa senza syscall. Il timeout multishot sostituisce il timerfd del frame.
+#define URING_ENTRIES            64
+#define URING_BUFS               16         // buffer forniti al kernel (potenza di 2)
+#define URING_BUF_SIZE           4096       // multiplo di sizeof(msg)
+#define URING_OP_READ_MULTISHOT  49         // kernel >= 6.7 (assente negli header più vecchi)
+#define URING_TIMEOUT_MULTISHOT  (1U << 6)  // kernel >= 6.4 (idem)
+#define URING_UD_READ            1          // user_data dei completamenti
+#define URING_UD_TICK            2
+#define URING_UD_INPUT           3
+#define URING_UD_CHILD           4
+
+typedef struct {
+    int fd;
+    void *ring_mem;                         // SQ e CQ (IORING_FEAT_SINGLE_MMAP)
+    size_t ring_sz;
+    struct io_uring_sqe *sqes;
+    size_t sqes_sz;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array, sq_entries;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    struct io_uring_buf_ring *br;           // buffer forniti (gruppo 0)
+    unsigned char *bufs;
+    unsigned short br_tail;
+    unsigned to_submit;                     // SQE preparate e non ancora consegnate
+    bool read_armed, tick_armed, input_armed, child_armed;
+    bool tick_multishot;                    // falso se il kernel rifiuta il timeout multishot
+    bool tick, input;                       // completamenti visti e non ancora consumati
+    bool eof;                               // tutti i produttori hanno chiuso
+    int cur_bid;                            // buffer in consumo
+    size_t cur_off, cur_len;
+} Uring;
+
+static Uring uring = { .fd = -1 };
+static int uring_fallback_errno = 0;        // --transport=uring non disponibile: motivo
+static struct __kernel_timespec uring_tick_ts; // durata del frame per l'SQE di timeout
+
+// Statistiche di drenaggio del frame corrente (riga di debug)
+static int frame_recv_syscalls = 0;         // read() eseguite nel frame
+static int frame_recv_msgs = 0;             // messaggi ricevuti nel frame
+
+// Capacità della pipe (--pipe-size=N) e occupazione campionata con FIONREAD a ogni frame
+#ifndef F_SETPIPE_SZ                        // in fcntl.h solo con _GNU_SOURCE
+#define F_SETPIPE_SZ 1031
+#define F_GETPIPE_SZ 1032
+#endif
+#define PIPE_SPARK_CELLS   20               // celle del grafico nella riga di debug
+#define PIPE_SPARK_FRAMES  8                // frame riassunti (massimo) in ogni cella
+#define PIPE_HIST_BUCKETS  10               // decili di occupazione per il riepilogo
+static int pipe_size_req = 0;               // byte richiesti (0 = default del kernel)
+static int pipe_capacity = 0;               // byte effettivi (F_GETPIPE_SZ)
+static int pipe_size_errno = 0;             // errno di F_SETPIPE_SZ se rifiutato
+static int frame_pipe_bytes = 0;            // occupazione all'inizio del frame
+static int pipe_spark[PIPE_SPARK_CELLS];    // massimi per cella (byte), il più recente in fondo
+static int pipe_spark_frames = 0;           // frame già accumulati nell'ultima cella
+static long long stat_pipe_samples = 0;
+static long long stat_pipe_bytes_sum = 0;
+static int stat_pipe_hwm = 0;               // high-water mark (byte)
+static long long stat_pipe_hist[PIPE_HIST_BUCKETS];
+
+// Ciclo principale (selezionabile a runtime con --loop=)
+#define LOOP_SLEEP  0                       // drenaggio + napms(16) fisso
+#define LOOP_EPOLL  1                       // epoll_wait su messaggi + timerfd con la scadenza del frame
+#define FRAME_US    16000                   // cadenza dei frame
+static int loop_mode = LOOP_EPOLL;
+static int loop_epoll_fd = -1;
+static int loop_timer_fd = -1;
+static int loop_msg_fd = -1;                // fd dei messaggi registrato in epoll (pipe o eventfd)
+static int loop_input_fd = -1;              // canale input registrato in epoll
+static msg pending_msgs[MAX_MSGS_PER_FRAME]; // drenati durante l'attesa, smistati al frame successivo
+static int pending_n = 0;
+
+// Raccolta dei figli terminati (selezionabile a runtime con --reap=)
+#define REAP_SIGNALFD 0                     // SIGCHLD su signalfd nel ciclo a eventi: waitpid solo dopo un'uscita
+#define REAP_POLL     1                     // waitpid a ogni frame e kill(pid, 0) su ogni entità a processo
+static int reap_mode = REAP_SIGNALFD;
+static int child_signal_fd = -1;
+static bool children_exited = false;        // SIGCHLD arrivato e figli non ancora raccolti
+static long long stat_liveness_syscalls = 0; // waitpid, kill(pid, 0) e letture della signalfd del padre
+static long long stat_children_reaped = 0;
+// Coccodrillo a posizioni muto da più di 2 s: processo morto in mezzo al fiume senza
+// OBJ_CROC_DESPAWN. Se era solo in ritardo, la prossima posizione lo ricrea.
+#define CROC_STALE_US 2000000LL
+static long long stat_crocs_stale = 0;      // coccodrilli liberati perché muti
+
+// Canale input: pochi messaggi, mai dietro al traffico dei coccodrilli
+#define INPUT_MAX_PER_FRAME   32            // tasti drenati al massimo per frame
+#define INPUT_DELAY_SAMPLES   8192          // ultimi ritardi di coda conservati per p50/p99
+static long long input_delay_us[INPUT_DELAY_SAMPLES];
+static long long input_delay_n = 0;         // campioni totali (l'array tiene gli ultimi)
+
+// Coalescenza degli aggiornamenti di posizione nel batch (--coalesce=off per disattivarla)
+#define COALESCE_BUCKETS  2048              // potenza di 2, >= 2x il batch massimo
+static int coalesce_enabled = 1;
+static int flow_control = 1;                // --flow=off: write-end bloccante come prima (confronto)
+static int croc_pool_enabled = 1;           // --croc-pool=off: una fork per coccodrillo come prima
+static int croc_lane_mode = 0;              // --croc-mode=lane: un processo per flusso, non per coccodrillo
+static int sim_local = 0;                   // --sim=local: coccodrilli simulati nel padre, senza processi
+static uint64_t sim_seed = 0;               // --seed=N: semina creatore e simulazione (0 = dall'orologio)
+
+// Modalità a corsie: ogni processo di flusso muove tutti i suoi coccodrilli e li identifica
+// con id sintetici negativi (mai pid reali, e -1 resta dei proiettili del padre)
+#define LANE_CROC_ID_FIRST  (-2)
+#define LANE_MAX_CROCS      (PIPE_BUF / (int)sizeof(msg)) // l'aggiornamento di corsia resta una write() atomica
+static int frame_pos_msgs = 0;              // aggiornamenti di posizione nel batch del frame
+static int frame_pos_skipped = 0;           // di cui superati da uno successivo dello stesso pid
+static int frame_inputs = 0;                // input della rana smistati nel frame
+static long long frame_input_t_sum = 0;     // somma dei loro istanti di invio
+static long long frame_input_t_min = 0;     // il più vecchio
+static int spawn_interval_ms = 0;           // --spawn-ms=N: ritmo di spawn forzato (0 = normale)
+static int croc_protocol = CROC_PROTO_POS;  // protocollo usato dai figli coccodrillo
+static int max_active_crocs = 16;           // --crocs=N: coccodrilli vivi al massimo (preset densi)
+
+// Statistiche di sessione del padre (stampate all'uscita con --stats)
+static int show_stats = 0;                  // --stats: riepilogo su stderr all'uscita
+static int session_secs = 0;                // --session-secs=N: esce da solo dopo N secondi
+static long long session_start_us = 0;
+static long long session_ctxt0 = -1;        // cambi di contesto di sistema all'avvio (/proc/stat)
+static long long stat_msgs_recv = 0;        // messaggi drenati dal padre
+static long long stat_frames = 0;           // frame eseguiti
+static long long stat_frame_us_sum = 0;     // tempo di lavoro dei frame (senza la pausa)
+static long long stat_frame_us_max = 0;
+static long long stat_pos_msgs = 0;         // aggiornamenti di posizione ricevuti
+static long long stat_pos_skipped = 0;      // di cui scartati dalla coalescenza
+static long long stat_inputs = 0;           // input della rana arrivati a schermo
+static long long stat_input_lat_sum = 0;    // latenza input -> schermo (tasto letto -> wrefresh)
+static long long stat_input_lat_max = 0;
+#if BITBOARD_CHECK
+static long long stat_bitboard_mismatch = 0; // disaccordi bitboard/corsie
+#endif
+
 
 static WINDOW *game_win = NULL;             // puntatore alla finestra ncurses di gioco
 static WINDOW *bg_win = NULL;               // finestra di background prerenderizzata
@@ -123,6 +357,16 @@ static bool is_frog_inside_tana_index(int idx);
 static bool all_tane_closed(void);
 static bool show_end_screen(int result, long long final_score);
 static void restart_game(pid_t* frog_pid, pid_t* creator_pid);
+static void parse_args(int argc, char **argv);
+static int run_bench(const char *name);
+static void stats_init(void);
+static void print_session_stats(void);
+static void print_arena_stats(void);
+static long long system_ctxt_switches(void);
+static long long producers_dropped(void);
+static void print_producer_stats(void);
+
+static const char *bench_name = NULL;       // --bench=<nome>: esegue un benchmark ed esce
 
 // Enum-like costanti per risultato finale
 #define END_VICTORY 1
@@ -136,6 +380,7 @@ static void add_score_for_death(void);
 // Stato logico rana mantenuto dal processo padre (consumatore)
 static int frog_x = 0;                      // posizione x della rana (padre)
 static int frog_y = 0;                      // posizione y della rana (padre)
+static int frog_prev_x = 0;                 // x della rana a inizio frame: [frog_prev_x, frog_x] è il tratto percorso
 static long long last_grenade_ms = -1000000000LL; // ultimo tempo di sparo (ms)
 
 static int lives = LIVES_START;
@@ -155,9 +400,45 @@ static const int SCORE_TIME_BONUS = 2;      // moltiplicatore sul tempo rimanent
 static const int SCORE_TIMEOUT_PENALTY = 10;// penalità per timeout
 static const int SCORE_DEATH_PENALTY = 20;  // penalità per morte
 
+// Tempo corrente in millisecondi (monotonic clock)
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000LL + (long long)ts.tv_nsec / 1000000LL;
+}
+
+// Tempo corrente in microsecondi (monotonic clock), per le misure di prestazioni
+static long long now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + (long long)ts.tv_nsec / 1000LL;
+}
+
+// Generatore pseudo-casuale piccolo e riproducibile (xorshift64*): lo stato si copia in un
+// messaggio o in una struct, quindi creatore, coccodrilli e simulazione locale lo condividono
+typedef struct {
+    uint64_t s;
+} Rng;
+
+// Semina con splitmix64: semi vicini danno stati lontani, e mai lo stato nullo
+static void rng_seed(Rng *r, uint64_t seed) {
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    r->s = z ? z : 1;
+}
+
+static uint32_t rng_next(Rng *r) {
+    r->s ^= r->s >> 12;
+    r->s ^= r->s << 25;
+    r->s ^= r->s >> 27;
+    return (uint32_t)((r->s * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
 // Inizializza direzioni dei flussi (alternanza partendo da un valore casuale)
-static void init_flussi(void) {
-    int start = rand() % 2;
+static void init_flussi(Rng *r) {
+    int start = (int)(rng_next(r) % 2);
     for (int i = 0; i < N_FLUSSI; i++) {
         flussi[i] = (i % 2 == 0) ? start : (1 - start);
     }
@@ -384,6 +665,7 @@ static void init_frog_state(void) {
     frog_y = Y_MARCIAPIEDE;                 // parte sul marciapiede
     frog_x = (max_x - FROG_W) / 2;          // centrata
     clamp_frog_position();                  // applica bounds
+    frog_prev_x = frog_x;
 }
 
 // Determina il colore appropriato per la rana basato sulla zona
@@ -423,31 +705,537 @@ static void draw_frog(void) {
     wattroff(game_win, COLOR_PAIR(pair));
 }
 
-// Stato semplice dei coccodrilli e dichiarazioni (devono venire prima dell'uso)
+// Stato "freddo" di un coccodrillo nell'arena: identità e protocollo. I dati letti a ogni
+// frame (x, y, velocità, dx_frame, pid) stanno negli array densi della sua corsia (CrocLane).
 typedef struct {
     int in_use;   // 0 = slot libero, 1 = occupato
     pid_t pid;    // pid del processo coccodrillo
-    int x;        // posizione corrente (assoluta)
-    int y;        // posizione corrente (assoluta)
-    int x_speed;  // velocità orizzontale del coccodrillo
+    int lane;     // corsia in croc_lanes[] (-1 finché non è collocato)
+    int pos;      // indice dentro la corsia
     int has_pos;  // 0 se non ha ancora una posizione valida
-    int dx_frame; // delta x accumulato in questo frame (per riding rana)
+    int dead_reckoned; // 1 se la x è calcolata dal padre (protocollo CROC_PROTO_DR)
+    long long last_seen; // now_us() dell'ultima posizione ricevuta (protocollo a posizioni)
+    int x0;            // x alla nascita (dead reckoning)
+    long long t0_us;   // istante di nascita (dead reckoning)
 } CrocState;
 
-#define MAX_CROCS 16
-static CrocState crocs[MAX_CROCS];
-
-// Struttura per i proiettili (usata anche per le granate della rana)
+// Stato freddo dei proiettili (usati anche per le granate della rana)
 typedef struct {
     int in_use;     // Slot attivo?
     pid_t pid;      // PID del processo proiettile
-    int x, y;       // Posizione
-    int direction;  // Direzione (-1 = sinistra, +1 = destra)
-    int id;         // OBJ_PROJECTILE (coccodrillo) oppure OBJ_GRENADE (granata rana)
+    int lane;       // corsia in projectile_lanes[] (-1 finché non è collocato)
+    int pos;        // indice dentro la corsia
+    int analytic;   // 1 se è un'entità del padre (nessun processo): x calcolata dal tempo
+    int x0;         // colonna di partenza (proiettili analitici)
+    long long t0_us; // istante dello sparo (proiettili analitici)
 } ProjectileState;
 
-#define MAX_PROJECTILES 32
-static ProjectileState projectiles[MAX_PROJECTILES];
+// Corsie: una per flusso del fiume più una per le righe che non iniziano un flusso.
+// Ogni corsia è compatta (niente buchi) e ordinata per x: le query della rana guardano
+// solo la corsia di frog_y e lì bastano una ricerca binaria e pochi elementi contigui.
+#define LANE_BUCKETS   (N_FLUSSI + 1)
+#define LANE_OTHER     N_FLUSSI
+#define LANE_INIT_CAP  8
+#define LANE_NO_PREV   INT_MIN        // entità appena collocata: nessun tratto percorso
+
+typedef struct {
+    int n, cap;
+    int sorted;       // 0 se qualche x è fuori ordine (si riordina in sort_entity_lanes)
+    int max_step;     // spostamento massimo |x - prev_x| nel frame (margine delle query)
+    int *x;
+    int *prev_x;      // x all'inizio del frame: [prev_x, x] è il tratto percorso
+    int *y;
+    int *speed;       // velocità orizzontale
+    int *dx_frame;    // delta x accumulato in questo frame (per riding rana)
+    pid_t *pid;
+    int *slot;        // slot dell'arena (stato freddo)
+} CrocLane;
+
+typedef struct {
+    int n, cap;
+    int sorted;
+    int max_step;
+    int *x;
+    int *prev_x;
+    int *y;
+    int *direction;   // -1 = sinistra, +1 = destra
+    int *id;          // OBJ_PROJECTILE oppure OBJ_GRENADE (negativo = da rimuovere)
+    pid_t *pid;
+    int *slot;
+} ProjectileLane;
+
+// Arene crescibili per coccodrilli e proiettili: partono piccole e raddoppiano
+// quando si riempiono, fino a ENTITY_ARENA_MAX slot
+#define CROC_ARENA_INIT        16
+#define PROJECTILE_ARENA_INIT  32
+#define ENTITY_ARENA_MAX       (1 << 18)
+
+// Handle di un'entità: slot nei bit bassi, generazione nei bit alti.
+// La generazione dello slot cambia a ogni rilascio, così un handle vecchio non
+// può più riferirsi per errore all'entità che riusa lo stesso slot.
+typedef uint32_t EntityHandle;
+#define HANDLE_SLOT_BITS  20
+#define HANDLE_SLOT_MASK  ((1u << HANDLE_SLOT_BITS) - 1)
+#define HANDLE_GEN_MASK   ((1u << (32 - HANDLE_SLOT_BITS)) - 1)   // bit di generazione che entrano nell'handle
+#define HANDLE_NONE       0xFFFFFFFFu
+
+// Indice pid -> handle a indirizzamento aperto (probing lineare, cancellazione con
+// backward shift: niente tombstone). Lookup e allocazione restano O(1) anche con
+// arene da migliaia di entità.
+typedef struct {
+    int cap;                // numero di bucket (2x gli slot: fattore di carico <= 0.5)
+    pid_t *keys;            // 0 = bucket vuoto
+    EntityHandle *handles;  // handle associato a keys[i]
+} PidIndex;
+
+// Metadati comuni alle due arene (gli elementi veri stanno in crocs[] / projectiles[])
+typedef struct {
+    int cap;                // slot allocati
+    int live;               // slot in uso
+    int high_water;         // massimo di slot in uso nella sessione
+    int grows;              // quante volte l'arena è cresciuta
+    long long dropped;      // aggiornamenti persi (arena al tetto o handle scaduto)
+    int *free_list;         // stack degli slot liberi
+    int free_n;
+    uint16_t *gen;          // generazione corrente di ogni slot
+    PidIndex index;         // pid -> handle
+} ArenaMeta;
+
+static CrocState *crocs = NULL;
+static ArenaMeta croc_arena = { 0 };
+static ProjectileState *projectiles = NULL;
+static ArenaMeta projectile_arena = { 0 };
+
+static EntityHandle make_handle(int slot, uint16_t gen) {
+    return ((EntityHandle)(gen & HANDLE_GEN_MASK) << HANDLE_SLOT_BITS) | (EntityHandle)slot;
+}
+
+// Bucket di partenza per un pid (hash moltiplicativo di Knuth)
+static int pid_index_home(const PidIndex *ix, pid_t pid) {
+    return (int)(((unsigned)pid * 2654435761u) % (unsigned)ix->cap);
+}
+
+// Handle associato al pid, HANDLE_NONE se assente
+static EntityHandle pid_index_find(const PidIndex *ix, pid_t pid) {
+    if (ix->cap == 0) return HANDLE_NONE;
+    for (int b = pid_index_home(ix, pid); ix->keys[b] != 0; b = (b + 1) % ix->cap) {
+        if (ix->keys[b] == pid) return ix->handles[b];
+    }
+    return HANDLE_NONE;
+}
+
+static void pid_index_insert(PidIndex *ix, pid_t pid, EntityHandle h) {
+    int b = pid_index_home(ix, pid);
+    while (ix->keys[b] != 0 && ix->keys[b] != pid) b = (b + 1) % ix->cap;
+    ix->keys[b] = pid;
+    ix->handles[b] = h;
+}
+
+static void pid_index_remove(PidIndex *ix, pid_t pid) {
+    if (ix->cap == 0) return;
+    int i = pid_index_home(ix, pid);
+    while (ix->keys[i] != pid) {
+        if (ix->keys[i] == 0) return;       // non presente
+        i = (i + 1) % ix->cap;
+    }
+    // Backward shift: riporta indietro le chiavi successive che non sono nel proprio bucket
+    int j = i;
+    for (;;) {
+        j = (j + 1) % ix->cap;
+        if (ix->keys[j] == 0) break;
+        int home = pid_index_home(ix, ix->keys[j]);
+        bool stays = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+        if (stays) continue;
+        ix->keys[i] = ix->keys[j];
+        ix->handles[i] = ix->handles[j];
+        i = j;
+    }
+    ix->keys[i] = 0;
+}
+
+// Porta i metadati a new_cap slot: free list, generazioni e indice (rehash)
+static bool arena_meta_grow(ArenaMeta *a, int new_cap) {
+    int *fl = realloc(a->free_list, (size_t)new_cap * sizeof(int));
+    if (!fl) return false;
+    a->free_list = fl;
+    uint16_t *gen = realloc(a->gen, (size_t)new_cap * sizeof(uint16_t));
+    if (!gen) return false;
+    a->gen = gen;
+
+    PidIndex nix = { 2 * new_cap, calloc((size_t)2 * new_cap, sizeof(pid_t)),
+                     malloc((size_t)2 * new_cap * sizeof(EntityHandle)) };
+    if (!nix.keys || !nix.handles) {
+        free(nix.keys);
+        free(nix.handles);
+        return false;
+    }
+    for (int b = 0; b < a->index.cap; b++) {
+        if (a->index.keys[b] != 0) pid_index_insert(&nix, a->index.keys[b], a->index.handles[b]);
+    }
+    free(a->index.keys);
+    free(a->index.handles);
+    a->index = nix;
+
+    // I nuovi slot entrano nella free list in ordine inverso: si usano dal più basso
+    for (int i = new_cap - 1; i >= a->cap; i--) {
+        a->gen[i] = 0;
+        a->free_list[a->free_n++] = i;
+    }
+    a->cap = new_cap;
+    a->grows++;
+    return true;
+}
+
+// Raddoppia l'arena dei coccodrilli (false se al tetto o senza memoria)
+static bool croc_arena_grow(void) {
+    int old_cap = croc_arena.cap;
+    int new_cap = old_cap ? old_cap * 2 : CROC_ARENA_INIT;
+    if (new_cap > ENTITY_ARENA_MAX) return false;
+    CrocState *n = realloc(crocs, (size_t)new_cap * sizeof(CrocState));
+    if (!n) return false;
+    memset(n + old_cap, 0, (size_t)(new_cap - old_cap) * sizeof(CrocState));
+    crocs = n;
+    return arena_meta_grow(&croc_arena, new_cap);
+}
+
+// Raddoppia l'arena dei proiettili (false se al tetto o senza memoria)
+static bool projectile_arena_grow(void) {
+    int old_cap = projectile_arena.cap;
+    int new_cap = old_cap ? old_cap * 2 : PROJECTILE_ARENA_INIT;
+    if (new_cap > ENTITY_ARENA_MAX) return false;
+    ProjectileState *n = realloc(projectiles, (size_t)new_cap * sizeof(ProjectileState));
+    if (!n) return false;
+    memset(n + old_cap, 0, (size_t)(new_cap - old_cap) * sizeof(ProjectileState));
+    projectiles = n;
+    return arena_meta_grow(&projectile_arena, new_cap);
+}
+
+// Prende uno slot libero dall'arena (dopo l'eventuale crescita), -1 se impossibile
+static int arena_take_slot(ArenaMeta *a, bool (*grow)(void)) {
+    if (a->free_n == 0 && !grow()) {
+        a->dropped++;                       // niente più spazio: l'aggiornamento va perso
+        return -1;
+    }
+    int i = a->free_list[--a->free_n];
+    a->live++;
+    if (a->live > a->high_water) a->high_water = a->live;
+    return i;
+}
+
+// Id sintetico di un coccodrillo: guidato da un processo di flusso (--croc-mode=lane)
+// o simulato nel padre (--sim=local)
+static bool is_lane_croc_id(pid_t id) {
+    return id <= LANE_CROC_ID_FIRST;
+}
+
+// Restituisce lo slot all'arena e invalida gli handle che lo riferivano
+static void arena_put_slot(ArenaMeta *a, int i, pid_t pid) {
+    if (pid > 0 || is_lane_croc_id(pid)) pid_index_remove(&a->index, pid);
+    a->gen[i] = (uint16_t)((a->gen[i] + 1) & HANDLE_GEN_MASK);   // ricomincia alla larghezza dell'handle
+    a->free_list[a->free_n++] = i;
+    a->live--;
+}
+
+static CrocLane croc_lanes[LANE_BUCKETS];
+static ProjectileLane projectile_lanes[LANE_BUCKETS];
+
+// Corsia di una riga: indice del flusso se la riga ne è l'inizio, altrimenti LANE_OTHER
+static int lane_of_y(int y) {
+    if (y < Y_FIUME || y >= Y_MARCIAPIEDE || (Y_MARCIAPIEDE - y) % FROG_H != 0) return LANE_OTHER;
+    return (Y_MARCIAPIEDE - y) / FROG_H - 1;   // inverso di flow_to_y()
+}
+
+// Prima posizione della corsia con x >= v (ricerca binaria sulle x ordinate)
+static int lane_lower_bound(const int *x, int n, int v) {
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (x[mid] < v) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+#define LANE_REALLOC(arr, new_cap) do {                                   \
+        void *p_ = realloc((arr), (size_t)(new_cap) * sizeof(*(arr)));   \
+        if (!p_) return false;                                           \
+        (arr) = p_;                                                      \
+    } while (0)
+
+// Garantisce spazio per un elemento in più (raddoppio)
+static bool croc_lane_reserve(CrocLane *L) {
+    if (L->n < L->cap) return true;
+    int nc = L->cap ? L->cap * 2 : LANE_INIT_CAP;
+    LANE_REALLOC(L->x, nc);
+    LANE_REALLOC(L->prev_x, nc);
+    LANE_REALLOC(L->y, nc);
+    LANE_REALLOC(L->speed, nc);
+    LANE_REALLOC(L->dx_frame, nc);
+    LANE_REALLOC(L->pid, nc);
+    LANE_REALLOC(L->slot, nc);
+    L->cap = nc;
+    return true;
+}
+
+static bool projectile_lane_reserve(ProjectileLane *L) {
+    if (L->n < L->cap) return true;
+    int nc = L->cap ? L->cap * 2 : LANE_INIT_CAP;
+    LANE_REALLOC(L->x, nc);
+    LANE_REALLOC(L->prev_x, nc);
+    LANE_REALLOC(L->y, nc);
+    LANE_REALLOC(L->direction, nc);
+    LANE_REALLOC(L->id, nc);
+    LANE_REALLOC(L->pid, nc);
+    LANE_REALLOC(L->slot, nc);
+    L->cap = nc;
+    return true;
+}
+
+// Scrive la x, aggiorna lo spostamento massimo del frame e segnala la corsia come da
+// riordinare se l'ordine con i vicini si rompe
+static void croc_lane_set_x(CrocLane *L, int p, int x) {
+    if (L->prev_x[p] == LANE_NO_PREV) L->prev_x[p] = x;   // prima posizione: tratto nullo
+    int step = abs(x - L->prev_x[p]);
+    if (step > L->max_step) L->max_step = step;
+    L->x[p] = x;
+    if ((p > 0 && L->x[p - 1] > x) || (p + 1 < L->n && L->x[p + 1] < x)) L->sorted = 0;
+}
+
+static void projectile_lane_set_x(ProjectileLane *L, int p, int x) {
+    if (L->prev_x[p] == LANE_NO_PREV) L->prev_x[p] = x;
+    int step = abs(x - L->prev_x[p]);
+    if (step > L->max_step) L->max_step = step;
+    L->x[p] = x;
+    if ((p > 0 && L->x[p - 1] > x) || (p + 1 < L->n && L->x[p + 1] < x)) L->sorted = 0;
+}
+
+// Toglie un coccodrillo dalla sua corsia facendo scorrere indietro i successivi:
+// la corsia resta compatta e ordinata
+static void croc_lane_remove(int slot) {
+    CrocState *c = &crocs[slot];
+    if (c->lane < 0) return;
+    CrocLane *L = &croc_lanes[c->lane];
+    for (int p = c->pos; p + 1 < L->n; p++) {
+        L->x[p] = L->x[p + 1];
+        L->prev_x[p] = L->prev_x[p + 1];
+        L->y[p] = L->y[p + 1];
+        L->speed[p] = L->speed[p + 1];
+        L->dx_frame[p] = L->dx_frame[p + 1];
+        L->pid[p] = L->pid[p + 1];
+        L->slot[p] = L->slot[p + 1];
+        crocs[L->slot[p]].pos = p;
+    }
+    L->n--;
+    c->lane = -1;
+}
+
+static void projectile_lane_remove(int slot) {
+    ProjectileState *ps = &projectiles[slot];
+    if (ps->lane < 0) return;
+    ProjectileLane *L = &projectile_lanes[ps->lane];
+    for (int p = ps->pos; p + 1 < L->n; p++) {
+        L->x[p] = L->x[p + 1];
+        L->prev_x[p] = L->prev_x[p + 1];
+        L->y[p] = L->y[p + 1];
+        L->direction[p] = L->direction[p + 1];
+        L->id[p] = L->id[p + 1];
+        L->pid[p] = L->pid[p + 1];
+        L->slot[p] = L->slot[p + 1];
+        projectiles[L->slot[p]].pos = p;
+    }
+    L->n--;
+    ps->lane = -1;
+}
+
+static void release_croc_slot(int i);
+static void release_projectile_slot(int i);
+
+// Colloca il coccodrillo nella corsia della riga y (in coda; se cambia corsia porta con sé
+// x, prev_x, velocità e dx_frame). Restituisce la posizione nella corsia; senza memoria libera lo
+// slot, conta l'aggiornamento come perso e restituisce -1.
+static int croc_place(int slot, int y) {
+    CrocState *c = &crocs[slot];
+    int lane = lane_of_y(y);
+    if (c->lane == lane) {
+        croc_lanes[lane].y[c->pos] = y;
+        return c->pos;
+    }
+    CrocLane *L = &croc_lanes[lane];
+    if (!croc_lane_reserve(L)) {
+        croc_arena.dropped++;
+        release_croc_slot(slot);
+        return -1;
+    }
+    int x = 0, prev_x = LANE_NO_PREV, speed = 0, dx = 0;
+    if (c->lane >= 0) {
+        const CrocLane *old = &croc_lanes[c->lane];
+        x = old->x[c->pos];
+        prev_x = old->prev_x[c->pos];
+        speed = old->speed[c->pos];
+        dx = old->dx_frame[c->pos];
+        croc_lane_remove(slot);
+    }
+    int p = L->n++;
+    L->y[p] = y;
+    L->speed[p] = speed;
+    L->dx_frame[p] = dx;
+    L->pid[p] = c->pid;
+    L->slot[p] = slot;
+    L->prev_x[p] = prev_x;
+    L->x[p] = x;                     // la x vera arriva con croc_lane_set_x() dal chiamante
+    if (p > 0 && L->x[p - 1] > x) L->sorted = 0;
+    c->lane = lane;
+    c->pos = p;
+    return p;
+}
+
+// Come croc_place() per i proiettili
+static int projectile_place(int slot, int y) {
+    ProjectileState *ps = &projectiles[slot];
+    int lane = lane_of_y(y);
+    if (ps->lane == lane) {
+        projectile_lanes[lane].y[ps->pos] = y;
+        return ps->pos;
+    }
+    ProjectileLane *L = &projectile_lanes[lane];
+    if (!projectile_lane_reserve(L)) {
+        projectile_arena.dropped++;
+        release_projectile_slot(slot);
+        return -1;
+    }
+    int x = 0, prev_x = LANE_NO_PREV, direction = 0, id = 0;
+    if (ps->lane >= 0) {
+        const ProjectileLane *old = &projectile_lanes[ps->lane];
+        x = old->x[ps->pos];
+        prev_x = old->prev_x[ps->pos];
+        direction = old->direction[ps->pos];
+        id = old->id[ps->pos];
+        projectile_lane_remove(slot);
+    }
+    int p = L->n++;
+    L->y[p] = y;
+    L->direction[p] = direction;
+    L->id[p] = id;
+    L->pid[p] = ps->pid;
+    L->slot[p] = slot;
+    L->prev_x[p] = prev_x;
+    L->x[p] = x;                     // la x vera arriva con projectile_lane_set_x() dal chiamante
+    if (p > 0 && L->x[p - 1] > x) L->sorted = 0;
+    ps->lane = lane;
+    ps->pos = p;
+    return p;
+}
+
+#define SWAP_INT(a, b) do { int t_ = (a); (a) = (b); (b) = t_; } while (0)
+
+// Riordina per x con insertion sort: tra un frame e l'altro l'ordine cambia poco
+// (stessa velocità nel flusso), quindi il costo è quasi lineare
+static void croc_lane_sort(CrocLane *L) {
+    if (L->sorted) return;
+    for (int i = 1; i < L->n; i++) {
+        for (int j = i; j > 0 && L->x[j - 1] > L->x[j]; j--) {
+            SWAP_INT(L->x[j - 1], L->x[j]);
+            SWAP_INT(L->prev_x[j - 1], L->prev_x[j]);
+            SWAP_INT(L->y[j - 1], L->y[j]);
+            SWAP_INT(L->speed[j - 1], L->speed[j]);
+            SWAP_INT(L->dx_frame[j - 1], L->dx_frame[j]);
+            SWAP_INT(L->slot[j - 1], L->slot[j]);
+            pid_t tp = L->pid[j - 1]; L->pid[j - 1] = L->pid[j]; L->pid[j] = tp;
+        }
+    }
+    for (int i = 0; i < L->n; i++) crocs[L->slot[i]].pos = i;
+    L->sorted = 1;
+}
+
+static void projectile_lane_sort(ProjectileLane *L) {
+    if (L->sorted) return;
+    for (int i = 1; i < L->n; i++) {
+        for (int j = i; j > 0 && L->x[j - 1] > L->x[j]; j--) {
+            SWAP_INT(L->x[j - 1], L->x[j]);
+            SWAP_INT(L->prev_x[j - 1], L->prev_x[j]);
+            SWAP_INT(L->y[j - 1], L->y[j]);
+            SWAP_INT(L->direction[j - 1], L->direction[j]);
+            SWAP_INT(L->id[j - 1], L->id[j]);
+            SWAP_INT(L->slot[j - 1], L->slot[j]);
+            pid_t tp = L->pid[j - 1]; L->pid[j - 1] = L->pid[j]; L->pid[j] = tp;
+        }
+    }
+    for (int i = 0; i < L->n; i++) projectiles[L->slot[i]].pos = i;
+    L->sorted = 1;
+}
+
+// Inizio frame: la posizione attuale diventa il punto di partenza del tratto percorso
+// in questo frame e i delta per il riding ripartono da zero
+static void begin_frame_lanes(void) {
+    for (int lane = 0; lane < LANE_BUCKETS; lane++) {
+        CrocLane *C = &croc_lanes[lane];
+        for (int p = 0; p < C->n; p++) {
+            C->prev_x[p] = C->x[p];
+            C->dx_frame[p] = 0;
+        }
+        C->max_step = 0;
+        ProjectileLane *P = &projectile_lanes[lane];
+        for (int p = 0; p < P->n; p++) P->prev_x[p] = P->x[p];
+        P->max_step = 0;
+    }
+}
+
+// Da chiamare dopo gli aggiornamenti del frame e prima delle query di collisione
+static void sort_entity_lanes(void) {
+    for (int lane = 0; lane < LANE_BUCKETS; lane++) {
+        croc_lane_sort(&croc_lanes[lane]);
+        projectile_lane_sort(&projectile_lanes[lane]);
+    }
+}
+
+// Coccodrillo riferito da un handle, NULL se lo slot è stato liberato nel frattempo
+static CrocState* croc_from_handle(EntityHandle h) {
+    if (h == HANDLE_NONE) return NULL;
+    int i = (int)(h & HANDLE_SLOT_MASK);
+    if (i >= croc_arena.cap || !crocs[i].in_use || croc_arena.gen[i] != ((h >> HANDLE_SLOT_BITS) & HANDLE_GEN_MASK)) {
+        croc_arena.dropped++;               // handle scaduto: aggiornamento scartato
+        return NULL;
+    }
+    return &crocs[i];
+}
+
+// Proiettile riferito da un handle, NULL se lo slot è stato liberato nel frattempo
+static ProjectileState* projectile_from_handle(EntityHandle h) {
+    if (h == HANDLE_NONE) return NULL;
+    int i = (int)(h & HANDLE_SLOT_MASK);
+    if (i >= projectile_arena.cap || !projectiles[i].in_use ||
+        projectile_arena.gen[i] != ((h >> HANDLE_SLOT_BITS) & HANDLE_GEN_MASK)) {
+        projectile_arena.dropped++;         // handle scaduto: aggiornamento scartato
+        return NULL;
+    }
+    return &projectiles[i];
+}
+
+// Libera uno slot coccodrillo: lo toglie da corsia e indice e lo rimette nella free list
+static void release_croc_slot(int i) {
+    if (!crocs[i].in_use) return;
+    croc_lane_remove(i);
+    arena_put_slot(&croc_arena, i, crocs[i].pid);
+    crocs[i].in_use = 0;
+    crocs[i].pid = -1;
+}
+
+// Libera uno slot proiettile (i proiettili analitici non sono nell'indice: pid -1)
+static void release_projectile_slot(int i) {
+    if (!projectiles[i].in_use) return;
+    projectile_lane_remove(i);
+    arena_put_slot(&projectile_arena, i, projectiles[i].pid);
+    projectiles[i].in_use = 0;
+    projectiles[i].pid = -1;
+}
+
+// Svuota entrambe le arene (la capacità raggiunta resta: niente riallocazioni a ogni partita)
+static void reset_entity_tables(void) {
+    if (croc_arena.cap == 0) croc_arena_grow();
+    if (projectile_arena.cap == 0) projectile_arena_grow();
+    for (int i = 0; i < croc_arena.cap; i++) release_croc_slot(i);
+    for (int i = 0; i < projectile_arena.cap; i++) release_projectile_slot(i);
+}
 
 // Forward declaration
 static CrocState* get_croc_slot(pid_t pid);
@@ -459,24 +1247,26 @@ static void draw_crocs(void) {
     int max_y, max_x;                                  // dimensioni finestra di gioco
     getmaxyx(game_win, max_y, max_x);                  // ottieni righe/colonne
 
-    for (int i = 0; i < MAX_CROCS; i++) {
-        if (!crocs[i].in_use) continue;               // salta slot vuoti
-        const char **sprite = (crocs[i].x_speed > 0) ? croc_sprite_right : croc_sprite_left;
-        wattron(game_win, COLOR_PAIR(COLORE_CROC));
-        for (int yy = 0; yy < CROC_H; yy++) {
-            for (int xx = 0; xx < CROC_W && sprite[yy][xx] != '\0'; xx++) {
-                char ch = sprite[yy][xx];
-                if (ch == ' ') continue;              // non disegnare spazi
-                int px = crocs[i].x + xx;             // x del carattere da disegnare
-                int py = crocs[i].y + yy;             // y del carattere da disegnare
-                if (px >= 1 && px < max_x - 1 && py >= 1 && py < max_y - 1) { // dentro i bordi
-                    // Usa mvwaddstr per caratteri multibyte UTF-8
-                    char temp[2] = {ch, '\0'};
-                    mvwaddstr(game_win, py, px, temp);
+    for (int lane = 0; lane < LANE_BUCKETS; lane++) {
+        const CrocLane *L = &croc_lanes[lane];
+        for (int p = 0; p < L->n; p++) {
+            const char **sprite = (L->speed[p] > 0) ? croc_sprite_right : croc_sprite_left;
+            wattron(game_win, COLOR_PAIR(COLORE_CROC));
+            for (int yy = 0; yy < CROC_H; yy++) {
+                for (int xx = 0; xx < CROC_W && sprite[yy][xx] != '\0'; xx++) {
+                    char ch = sprite[yy][xx];
+                    if (ch == ' ') continue;              // non disegnare spazi
+                    int px = L->x[p] + xx;                // x del carattere da disegnare
+                    int py = L->y[p] + yy;                // y del carattere da disegnare
+                    if (px >= 1 && px < max_x - 1 && py >= 1 && py < max_y - 1) { // dentro i bordi
+                        // Usa mvwaddstr per caratteri multibyte UTF-8
+                        char temp[2] = {ch, '\0'};
+                        mvwaddstr(game_win, py, px, temp);
+                    }
                 }
             }
+            wattroff(game_win, COLOR_PAIR(COLORE_CROC));
         }
-        wattroff(game_win, COLOR_PAIR(COLORE_CROC));
     }
 }
 
@@ -484,96 +1274,108 @@ static void draw_crocs(void) {
 static void draw_projectiles(void) {
     wattron(game_win, COLOR_PAIR(COLORE_PROJECTILE)); // nero su blu
     int max_y, max_x; getmaxyx(game_win, max_y, max_x);
-    for (int i = 0; i < MAX_PROJECTILES; i++) {
-        if (!projectiles[i].in_use) continue;
-        int px = projectiles[i].x;
-        int py = projectiles[i].y;
-        if (px >= 1 && px < max_x - 1 && py >= 1 && py < max_y - 1) {
-            // Caratteri speciali: 𖦹 per granate rana, ► per proiettili coccodrilli
-            const char *ch = (projectiles[i].id == OBJ_GRENADE) ? "◆" : "►";
-            mvwaddstr(game_win, py, px, ch);
+    for (int lane = 0; lane < LANE_BUCKETS; lane++) {
+        const ProjectileLane *L = &projectile_lanes[lane];
+        for (int p = 0; p < L->n; p++) {
+            int px = L->x[p];
+            int py = L->y[p];
+            if (px >= 1 && px < max_x - 1 && py >= 1 && py < max_y - 1) {
+                // Caratteri speciali: 𖦹 per granate rana, ► per proiettili coccodrilli
+                const char *ch = (L->id[p] == OBJ_GRENADE) ? "◆" : "►";
+                mvwaddstr(game_win, py, px, ch);
+            }
         }
     }
     wattroff(game_win, COLOR_PAIR(COLORE_PROJECTILE));
 }
 
-// Libera gli slot dei coccodrilli fuori dallo schermo (evita saturazione di slot)
-// Libera gli slot dei coccodrilli che sono usciti dai bordi della finestra
-static void sweep_crocs_offscreen(void) {
-    int max_y, max_x;                           // dimensioni finestra di gioco
-    getmaxyx(game_win, max_y, max_x);           // ottieni righe/colonne
-    int left_edge = 1;                          // bordo interno sinistro (+1 per bordo finestra)
-    int right_edge = max_x - 2;                 // bordo interno destro (-1 per bordo, -1 indice)
-    for (int i = 0; i < MAX_CROCS; i++) {       // scorri tutti gli slot
-        if (!crocs[i].in_use) continue;         // salta gli slot liberi
-        // se il processo del coccodrillo è terminato, libera lo slot
-        if (crocs[i].pid > 0) {
-            if (kill(crocs[i].pid, 0) == -1 && errno == ESRCH) {
-                crocs[i].in_use = 0;
-                crocs[i].pid = -1;
+// Libera gli slot dei coccodrilli fuori da [left_edge, right_edge] (evita saturazione di slot)
+static void sweep_crocs_outside(int left_edge, int right_edge) {
+    long long t = now_us();
+    for (int lane = 0; lane < LANE_BUCKETS; lane++) {
+        CrocLane *L = &croc_lanes[lane];
+        // All'indietro: il rilascio compatta la corsia spostando solo gli elementi successivi
+        for (int p = L->n - 1; p >= 0; p--) {
+            int i = L->slot[p];
+            // se il processo del coccodrillo è terminato, libera lo slot (solo con --reap=poll:
+            // altrimenti lo annuncia il suo OBJ_CROC_DESPAWN)
+            if (reap_mode == REAP_POLL && L->pid[p] > 0) {
+                stat_liveness_syscalls++;
+                if (kill(L->pid[p], 0) == -1 && errno == ESRCH) {
+                    release_croc_slot(i);
+                    continue;
+                }
+            }
+
+            // Niente posizioni da troppo tempo: con --reap=signalfd nessuno sonda il processo,
+            // quindi un coccodrillo ucciso (o con l'uscita persa) resterebbe nell'arena
+            if (!crocs[i].dead_reckoned && crocs[i].has_pos && t - crocs[i].last_seen > CROC_STALE_US) {
+                stat_crocs_stale++;
+                release_croc_slot(i);
                 continue;
             }
-        }
 
-        // Libera se completamente fuori dalla finestra interna
-        if (crocs[i].x > right_edge || (crocs[i].x + CROC_W - 1) < left_edge) {
-            crocs[i].in_use = 0;
-            crocs[i].pid = -1;
-            continue;
-        }
+            // Libera se completamente fuori dalla finestra interna
+            if (L->x[p] > right_edge || (L->x[p] + CROC_W - 1) < left_edge) {
+                release_croc_slot(i);
+                continue;
+            }
 
-        // Caso di uscita imminente: il figlio ha già incrementato e terminato,
-        // l'ultimo x ricevuto è ancora al bordo. Considera off-screen ora.
-        if (crocs[i].x_speed > 0 && crocs[i].x >= right_edge) {
-            crocs[i].in_use = 0;
-            crocs[i].pid = -1;
-            continue;
-        }
-        if (crocs[i].x_speed < 0 && (crocs[i].x + CROC_W - 1) <= left_edge) {
-            crocs[i].in_use = 0;
-            crocs[i].pid = -1;
-            continue;
+            // Caso di uscita imminente: il figlio ha già incrementato e terminato,
+            // l'ultimo x ricevuto è ancora al bordo. Considera off-screen ora.
+            if (L->speed[p] > 0 && L->x[p] >= right_edge) {
+                release_croc_slot(i);
+                continue;
+            }
+            if (L->speed[p] < 0 && (L->x[p] + CROC_W - 1) <= left_edge) {
+                release_croc_slot(i);
+                continue;
+            }
         }
     }
 }
 
-// Libera gli slot dei proiettili fuori schermo o terminati
-static void sweep_projectiles_offscreen(void) {
-    int max_y, max_x;
-    getmaxyx(game_win, max_y, max_x);
-    int left_edge = 1;
-    int right_edge = max_x - 2;
-
-    for (int i = 0; i < MAX_PROJECTILES; i++) {
-        if (!projectiles[i].in_use) continue;
+// Libera gli slot dei coccodrilli che sono usciti dai bordi della finestra
+static void sweep_crocs_offscreen(void) {
+    int max_y, max_x;                           // dimensioni finestra di gioco
+    getmaxyx(game_win, max_y, max_x);           // ottieni righe/colonne
+    // bordo interno sinistro (+1 per bordo finestra), destro (-1 per bordo, -1 indice)
+    sweep_crocs_outside(1, max_x - 2);
+}
 
-        // Se il processo del proiettile è terminato, libera lo slot
-        if (projectiles[i].pid > 0) {
-            if (kill(projectiles[i].pid, 0) == -1 && errno == ESRCH) {
-                projectiles[i].in_use = 0;
-                projectiles[i].pid = -1;
-                continue;
+// Libera gli slot dei proiettili fuori da [left_edge, right_edge] o terminati
+static void sweep_projectiles_outside(int left_edge, int right_edge) {
+    for (int lane = 0; lane < LANE_BUCKETS; lane++) {
+        ProjectileLane *L = &projectile_lanes[lane];
+        for (int p = L->n - 1; p >= 0; p--) {   // all'indietro, come per i coccodrilli
+            int i = L->slot[p];
+
+            // Se il processo del proiettile è terminato, libera lo slot (solo con --reap=poll:
+            // altrimenti lo annuncia il suo OBJ_PROJECTILE_GONE)
+            if (reap_mode == REAP_POLL && L->pid[p] > 0) {
+                stat_liveness_syscalls++;
+                if (kill(L->pid[p], 0) == -1 && errno == ESRCH) {
+                    release_projectile_slot(i);
+                    continue;
+                }
             }
-        }
-
-        // Libera se completamente fuori schermo (consenti x==right_edge come ultimo visibile)
-        if (projectiles[i].x < left_edge || projectiles[i].x > right_edge) {
-            projectiles[i].in_use = 0;
-            projectiles[i].pid = -1;
-            continue;
-        }
 
-        // Se il processo è terminato, libera subito lo slot
-        if (projectiles[i].pid > 0) {
-            if (kill(projectiles[i].pid, 0) == -1 && errno == ESRCH) {
-                projectiles[i].in_use = 0;
-                projectiles[i].pid = -1;
+            // Libera se completamente fuori schermo (consenti x==right_edge come ultimo visibile)
+            if (L->x[p] < left_edge || L->x[p] > right_edge) {
+                release_projectile_slot(i);
                 continue;
             }
         }
     }
 }
 
+// Libera gli slot dei proiettili fuori dalla finestra di gioco o terminati
+static void sweep_projectiles_offscreen(void) {
+    int max_y, max_x;
+    getmaxyx(game_win, max_y, max_x);
+    sweep_projectiles_outside(1, max_x - 2);
+}
+
 // Verifica se la rana è sopra un coccodrillo. Se sì, restituisce true e
 // scrive in out_dx la velocità orizzontale del coccodrillo (per "riding").
 // Rileva se la rana è interamente appoggiata su un coccodrillo della stessa riga
@@ -583,20 +1385,35 @@ static bool is_frog_on_croc(int* out_dx) {
     int frog_left  = frog_x;                 // bordo sinistro della rana
     int frog_right = frog_x + FROG_W - 1;    // bordo destro della rana
 
-    for (int i = 0; i < MAX_CROCS; i++) {
-        if (!crocs[i].in_use) continue;     // ignora slot vuoti
-
+    // Solo la corsia della rana; i coccodrilli che si sovrappongono hanno x in
+    // [frog_left - CROC_W + 1, frog_right] e sono contigui perché la corsia è ordinata
+    const CrocLane *L = &croc_lanes[lane_of_y(frog_y)];
+    for (int p = lane_lower_bound(L->x, L->n, frog_left - CROC_W + 1); p < L->n && L->x[p] <= frog_right; p++) {
         // stessa riga/flow: croc e rana hanno la stessa altezza (FROG_H)
-        if (frog_y != crocs[i].y) continue; // deve stare sulla stessa riga (flusso)
+        if (frog_y != L->y[p]) continue;    // conta solo nella corsia LANE_OTHER
+        if (out_dx) *out_dx = L->dx_frame[p]; // restituisce il delta del frame del croc
+        return true;                        // conferma che è sopra
+    }
+    return false;
+}
 
-        int croc_left  = crocs[i].x;        // bordo sinistro del coccodrillo
-        int croc_right = crocs[i].x + CROC_W - 1; // bordo destro del coccodrillo
+// Come is_frog_on_croc(), ma contro la posizione dei coccodrilli all'inizio del frame, cioè
+// dove la rana stava davvero: un coccodrillo che in un frame avanza di più colonne di
+// quante ne condivide con la rana la trascina con sé invece di sfilarsi da sotto
+static bool is_frog_riding_croc(int* out_dx) {
+    if (out_dx) *out_dx = 0;
 
-        // la rana deve essere almeno parzialmente appoggiata sul coccodrillo
-        if (frog_left <= croc_right && frog_right >= croc_left) { // overlap orizzontale
-            if (out_dx) *out_dx = crocs[i].dx_frame; // restituisce il delta del frame del croc
-            return true;                            // conferma che è sopra
-        }
+    int frog_left  = frog_x;
+    int frog_right = frog_x + FROG_W - 1;
+
+    // prev_x dista al più max_step dalla x, su cui è ordinata la corsia
+    const CrocLane *L = &croc_lanes[lane_of_y(frog_y)];
+    int lo = frog_left - CROC_W + 1 - L->max_step;
+    for (int p = lane_lower_bound(L->x, L->n, lo); p < L->n && L->x[p] <= frog_right + L->max_step; p++) {
+        if (frog_y != L->y[p]) continue;
+        if (L->prev_x[p] > frog_right || L->prev_x[p] + CROC_W - 1 < frog_left) continue;
+        if (out_dx) *out_dx = L->dx_frame[p];
+        return true;
     }
     return false;
 }
@@ -609,16 +1426,12 @@ static void snap_frog_onto_croc_edge_if_partial(void) {
     int frog_left  = frog_x;
     int frog_right = frog_x + FROG_W - 1;
 
-    for (int i = 0; i < MAX_CROCS; i++) {
-        if (!crocs[i].in_use) continue;
-        if (crocs[i].y != frog_y) continue; // stesso flusso
-
-        int croc_left  = crocs[i].x;
-        int croc_right = crocs[i].x + CROC_W - 1;
+    const CrocLane *L = &croc_lanes[lane_of_y(frog_y)];
+    for (int p = lane_lower_bound(L->x, L->n, frog_left - CROC_W + 1); p < L->n && L->x[p] <= frog_right; p++) {
+        if (L->y[p] != frog_y) continue; // stesso flusso
 
-        // Verifica sovrapposizione orizzontale parziale (qualche colonna in comune)
-        bool overlap = (frog_left <= croc_right && frog_right >= croc_left);
-        if (!overlap) continue;
+        int croc_left  = L->x[p];
+        int croc_right = L->x[p] + CROC_W - 1;
 
         int overlap_left  = (frog_left   > croc_left)  ? frog_left  : croc_left;
         int overlap_right = (frog_right  < croc_right) ? frog_right : croc_right;
@@ -667,106 +1480,338 @@ static bool all_tane_closed(void) {
     return true;
 }
 
+// Colonne toccate dalla rana nel frame, dalla x di partenza alla finale (solo per i filtri:
+// corsia e bitboard; il test esatto è projectile_swept_hits_frog)
+static void frog_swept_span(int *lo, int *hi) {
+    *lo = (frog_prev_x < frog_x) ? frog_prev_x : frog_x;
+    *hi = ((frog_prev_x < frog_x) ? frog_x : frog_prev_x) + FROG_W - 1;
+}
+
+// Lato della colonna x rispetto alla rana in fx: -1 a sinistra, 0 sopra la rana, +1 a destra
+static int side_of_frog(int x, int fx) {
+    if (x < fx) return -1;
+    if (x > fx + FROG_W - 1) return 1;
+    return 0;
+}
+
+// Proiettile (p0 -> p1) e rana (frog_prev_x -> frog_x) si toccano nel frame se sono
+// sovrapposti all'inizio o alla fine, oppure se il proiettile è passato da un lato all'altro
+// della rana (come grenade_hits_projectile_swept). Un proiettile che insegue la rana senza
+// raggiungerla resta sempre dallo stesso lato: nessun colpo.
+static bool projectile_swept_hits_frog(int p0, int p1) {
+    int s0 = side_of_frog(p0, frog_prev_x), s1 = side_of_frog(p1, frog_x);
+    return s0 == 0 || s1 == 0 || s0 != s1;
+}
+
+// Slot del primo proiettile dei coccodrilli che tocca la rana, -1 se nessuno.
+// Guarda solo le corsie delle righe occupate dalla rana, con ricerca binaria sulla x.
+// Vale il moto nel frame di entrambi (prev_x -> x): nessuno dei due può scavalcare l'altro
+// avanzando di più colonne in un frame.
+static int find_projectile_hitting_frog(void) {
+    int frog_lo, frog_hi;
+    frog_swept_span(&frog_lo, &frog_hi);
+    int seen[FROG_H];
+    for (int r = 0; r < FROG_H; r++) {
+        int lane = lane_of_y(frog_y + r);
+        seen[r] = lane;
+        bool dup = false;
+        for (int k = 0; k < r; k++) if (seen[k] == lane) dup = true;
+        if (dup) continue;                   // corsia già controllata (tipicamente LANE_OTHER)
+
+        const ProjectileLane *L = &projectile_lanes[lane];
+        int lo = frog_lo - L->max_step, hi = frog_hi + L->max_step;
+        for (int p = lane_lower_bound(L->x, L->n, lo); p < L->n && L->x[p] <= hi; p++) {
+            // Considera solo i proiettili dei coccodrilli per danneggiare la rana
+            if (L->id[p] != OBJ_PROJECTILE) continue;
+            if (L->y[p] < frog_y || L->y[p] >= frog_y + FROG_H) continue;
+            if (projectile_swept_hits_frog(L->prev_x[p], L->x[p])) return L->slot[p];
+        }
+    }
+    return -1;
+}
+
+// Bitboard di riga: le GAME_WIDTH (101) colonne del campo stanno in due parole da 64 bit.
+// Ricostruite una volta per frame, rendono le collisioni della rana qualche AND su 2 parole,
+// indipendentemente dal numero di entità.
+#define ROW_WORDS 2
+
+typedef struct {
+    uint64_t w[ROW_WORDS];
+} RowBits;
+
+static RowBits croc_rows[GAME_HEIGHT];      // colonne coperte da un coccodrillo che inizia in quella riga
+static RowBits hostile_rows[GAME_HEIGHT];   // colonne percorse nel frame da un proiettile dei coccodrilli
+
+// Maschera delle colonne [lo, hi], limitata al campo
+static RowBits row_bits_span(int lo, int hi) {
+    RowBits b = { { 0, 0 } };
+    if (lo < 0) lo = 0;
+    if (hi > GAME_WIDTH - 1) hi = GAME_WIDTH - 1;
+    for (int k = 0; k < ROW_WORDS; k++) {
+        int a = (lo > k * 64) ? lo : k * 64;
+        int z = (hi < k * 64 + 63) ? hi : k * 64 + 63;
+        if (a > z) continue;
+        int len = z - a + 1;
+        uint64_t m = (len == 64) ? ~0ULL : ((1ULL << len) - 1);
+        b.w[k] = m << (a - k * 64);
+    }
+    return b;
+}
+
+static bool row_bits_intersect(const RowBits *a, const RowBits *b) {
+    return ((a->w[0] & b->w[0]) | (a->w[1] & b->w[1])) != 0;
+}
+
+// Ricostruisce le bitboard dalle corsie (da chiamare dopo gli aggiornamenti del frame)
+static void rebuild_collision_bitboards(void) {
+    memset(croc_rows, 0, sizeof(croc_rows));
+    memset(hostile_rows, 0, sizeof(hostile_rows));
+    for (int lane = 0; lane < LANE_BUCKETS; lane++) {
+        const CrocLane *C = &croc_lanes[lane];
+        for (int p = 0; p < C->n; p++) {
+            if (C->y[p] < 0 || C->y[p] >= GAME_HEIGHT) continue;
+            RowBits m = row_bits_span(C->x[p], C->x[p] + CROC_W - 1);
+            croc_rows[C->y[p]].w[0] |= m.w[0];
+            croc_rows[C->y[p]].w[1] |= m.w[1];
+        }
+        const ProjectileLane *P = &projectile_lanes[lane];
+        for (int p = 0; p < P->n; p++) {
+            if (P->id[p] != OBJ_PROJECTILE) continue;
+            int y = P->y[p];
+            if (y < 0 || y >= GAME_HEIGHT) continue;
+            int a = (P->prev_x[p] < P->x[p]) ? P->prev_x[p] : P->x[p];
+            int b = (P->prev_x[p] < P->x[p]) ? P->x[p] : P->prev_x[p];
+            RowBits m = row_bits_span(a, b);    // tratto percorso nel frame
+            hostile_rows[y].w[0] |= m.w[0];
+            hostile_rows[y].w[1] |= m.w[1];
+        }
+    }
+}
+
+// Rana (anche parzialmente) su un coccodrillo della sua riga: stessa risposta di is_frog_on_croc()
+static bool bitboard_frog_on_croc(void) {
+    if (frog_y < 0 || frog_y >= GAME_HEIGHT) return false;
+    RowBits frog = row_bits_span(frog_x, frog_x + FROG_W - 1);
+    return row_bits_intersect(&croc_rows[frog_y], &frog);
+}
+
+// Filtro: un proiettile dei coccodrilli è passato (nel frame) per una colonna toccata dalla
+// rana. Vero per ogni colpo, ma anche per chi la insegue: conferma find_projectile_hitting_frog
+static bool bitboard_projectile_hits_frog(void) {
+    int frog_lo, frog_hi;
+    frog_swept_span(&frog_lo, &frog_hi);
+    RowBits frog = row_bits_span(frog_lo, frog_hi);
+    for (int r = 0; r < FROG_H; r++) {
+        int y = frog_y + r;
+        if (y < 0 || y >= GAME_HEIGHT) continue;
+        if (row_bits_intersect(&hostile_rows[y], &frog)) return true;
+    }
+    return false;
+}
+
 // Verifica collisioni tra proiettili e rana
 static bool check_projectile_collision(void) {
-    for (int i = 0; i < MAX_PROJECTILES; i++) {
-        if (!projectiles[i].in_use) continue;
-        // Considera solo i proiettili dei coccodrilli per danneggiare la rana
-        if (projectiles[i].id != OBJ_PROJECTILE) continue;
-
-        // Collisione semplice: se il proiettile è nella stessa posizione della rana
-        if (projectiles[i].x >= frog_x && projectiles[i].x < frog_x + FROG_W &&
-            projectiles[i].y >= frog_y && projectiles[i].y < frog_y + FROG_H) {
-            // Collisione! Rimuovi il proiettile
-            projectiles[i].in_use = 0;
-            if (projectiles[i].pid > 0) {
-                terminate_process(projectiles[i].pid);
-                projectiles[i].pid = -1;
-            }
-            return true; // collisione avvenuta
-        }
+    // Le bitboard dicono in tempo costante se c'è un colpo; la corsia serve solo a trovare quale
+    if (!bitboard_projectile_hits_frog()) return false;
+    int i = find_projectile_hitting_frog();
+    if (i < 0) return false; // nessuna collisione
+    // Collisione! Rimuovi il proiettile
+    if (projectiles[i].pid > 0) {
+        terminate_process(projectiles[i].pid);
     }
-    return false; // nessuna collisione
+    release_projectile_slot(i);
+    return true; // collisione avvenuta
 }
 
 // (Rimossa) Le granate usano ora gli slot dei proiettili
 
-// Verifica collisioni granata vs proiettile: se collisione, rimuovi entrambi
-static void check_grenade_vs_projectile(void) {
-    // Collisione tra proiettili rana (OBJ_GRENADE) e proiettili coccodrillo (OBJ_PROJECTILE)
-    for (int i = 0; i < MAX_PROJECTILES; i++) {
-        if (!projectiles[i].in_use || projectiles[i].id != OBJ_GRENADE) continue;
-        for (int j = 0; j < MAX_PROJECTILES; j++) {
-            if (!projectiles[j].in_use || projectiles[j].id != OBJ_PROJECTILE) continue;
-            if (projectiles[i].y == projectiles[j].y) {
-                int gx = projectiles[i].x;
-                int px = projectiles[j].x;
-                int gd = projectiles[i].direction;
-                int pd = projectiles[j].direction;
-
-                bool same_cell = (gx == px);
-                bool crossing  = (abs(gx - px) == 1) && (gd != 0) && (pd != 0) && (gd == -pd);
-                if (same_cell || crossing) {
-                    if (projectiles[i].pid > 0) {
-                        terminate_process(projectiles[i].pid);
-                        projectiles[i].pid = -1;
-                    }
-                    projectiles[i].in_use = 0;
+// Granata e proiettile si annullano se sono nella stessa cella o se si incrociano
+// (celle adiacenti, direzioni opposte: al passo successivo si scavalcherebbero)
+static bool grenade_hits_projectile(int gx, int gd, int px, int pd) {
+    bool same_cell = (gx == px);
+    bool crossing  = (abs(gx - px) == 1) && (gd != 0) && (pd != 0) && (gd == -pd);
+    return same_cell || crossing;
+}
 
-                    if (projectiles[j].pid > 0) {
-                        terminate_process(projectiles[j].pid);
-                        projectiles[j].pid = -1;
-                    }
-                    projectiles[j].in_use = 0;
-                }
+// Come sopra sui tratti percorsi nel frame (g0 -> g1, p0 -> p1): se l'ordine relativo
+// si è invertito, nel frame si sono scavalcati anche senza mai essere adiacenti
+static bool grenade_hits_projectile_swept(int g0, int g1, int gd, int p0, int p1, int pd) {
+    if ((long long)(g0 - p0) * (g1 - p1) < 0) return true;
+    return grenade_hits_projectile(g1, gd, p1, pd);
+}
+
+// Rimuove in un solo passaggio gli elementi della corsia con id negativo (invece di
+// una rimozione con scorrimento per ciascuno)
+static void projectile_lane_compact(ProjectileLane *L) {
+    int w = 0;
+    for (int p = 0; p < L->n; p++) {
+        int i = L->slot[p];
+        if (L->id[p] > 0) {
+            L->x[w] = L->x[p];
+            L->prev_x[w] = L->prev_x[p];
+            L->y[w] = L->y[p];
+            L->direction[w] = L->direction[p];
+            L->id[w] = L->id[p];
+            L->pid[w] = L->pid[p];
+            L->slot[w] = i;
+            projectiles[i].pos = w++;
+            continue;
+        }
+        if (L->pid[p] > 0) {
+            terminate_process(L->pid[p]);
+        }
+        projectiles[i].lane = -1;   // già fuori dalla corsia: il rilascio non la tocca
+        release_projectile_slot(i);
+    }
+    L->n = w;
+}
+
+// Verifica collisioni granata vs proiettile: se collisione, rimuovi entrambi.
+// Sweep sulle corsie già ordinate per x: per ogni granata bastano i vicini con x a
+// distanza <= max(1, 2*max_step) (due entità che si scavalcano nel frame finiscono al più
+// a quella distanza), quindi il costo è lineare nel numero di proiettili (più le coppie).
+// Ogni granata e ogni proiettile coinvolto in almeno una coppia viene rimosso, così il
+// risultato non dipende dall'ordine di scansione.
+static void check_grenade_vs_projectile(void) {
+    for (int lane = 0; lane < LANE_BUCKETS; lane++) {
+        ProjectileLane *L = &projectile_lanes[lane];
+        bool hit = false;
+        for (int i = 0; i < L->n; i++) {
+            if (abs(L->id[i]) != OBJ_GRENADE) continue;
+            int gx = L->x[i];
+            int reach = (2 * L->max_step > 1) ? 2 * L->max_step : 1;
+            // Vicini a sinistra (x >= gx-reach) e a destra (x <= gx+reach) nella stessa corsia
+            for (int j = i - 1; j >= 0 && L->x[j] >= gx - reach; j--) {
+                if (abs(L->id[j]) != OBJ_PROJECTILE || L->y[j] != L->y[i]) continue;
+                if (!grenade_hits_projectile_swept(L->prev_x[i], gx, L->direction[i],
+                                                   L->prev_x[j], L->x[j], L->direction[j])) continue;
+                L->id[i] = -OBJ_GRENADE;      // id negativo = da rimuovere (il tipo resta leggibile)
+                L->id[j] = -OBJ_PROJECTILE;
+                hit = true;
+            }
+            for (int j = i + 1; j < L->n && L->x[j] <= gx + reach; j++) {
+                if (abs(L->id[j]) != OBJ_PROJECTILE || L->y[j] != L->y[i]) continue;
+                if (!grenade_hits_projectile_swept(L->prev_x[i], gx, L->direction[i],
+                                                   L->prev_x[j], L->x[j], L->direction[j])) continue;
+                L->id[i] = -OBJ_GRENADE;
+                L->id[j] = -OBJ_PROJECTILE;
+                hit = true;
             }
         }
+        if (hit) projectile_lane_compact(L);
     }
 }
 
 // Trova uno slot per un pid esistente, altrimenti ne alloca uno nuovo
 // Restituisce lo slot associato al pid del coccodrillo, o ne crea uno nuovo
 static CrocState* get_croc_slot(pid_t pid) {
-    // cerca se esiste già
-    for (int i = 0; i < MAX_CROCS; i++) {
-        if (crocs[i].in_use && crocs[i].pid == pid) {
-            return &crocs[i];
-        }
+    // cerca se esiste già (indice pid -> handle)
+    EntityHandle h = pid_index_find(&croc_arena.index, pid);
+    if (h != HANDLE_NONE) return croc_from_handle(h);
+    // altrimenti prende uno slot dalla free list (l'arena cresce se serve)
+    int i = arena_take_slot(&croc_arena, croc_arena_grow);
+    if (i < 0) return NULL; // arena al tetto: aggiornamento contato come perso
+    crocs[i].in_use = 1;
+    crocs[i].pid = pid;
+    crocs[i].lane = -1;   // collocato in una corsia alla prima posizione
+    crocs[i].has_pos = 0;
+    crocs[i].dead_reckoned = 0;
+    crocs[i].last_seen = now_us();
+    pid_index_insert(&croc_arena.index, pid, make_handle(i, croc_arena.gen[i]));
+    return &crocs[i];
+}
+
+// Applica un messaggio di posizione OBJ_CROC allo slot del coccodrillo mittente
+static void apply_croc_position(const msg *m) {
+    CrocState* cs = get_croc_slot(m->pid); // Cerco (o alloco) lo slot del coccodrillo corrispondente al pid ricevuto.
+    if (!cs) return;
+    cs->last_seen = now_us();
+    int p = croc_place((int)(cs - crocs), m->y); // corsia della riga ricevuta
+    if (p < 0) return;
+    CrocLane *L = &croc_lanes[cs->lane];
+    if (cs->has_pos) {
+        L->dx_frame[p] += (m->x - L->x[p]); // accumula il delta mosso in questo frame
+    } else {
+        cs->has_pos = 1; // prima posizione valida
+        // niente delta al primo update per evitare salti
     }
-    // altrimenti trova uno slot libero
-    for (int i = 0; i < MAX_CROCS; i++) {
-        if (!crocs[i].in_use) {
-            crocs[i].in_use = 1;
-            crocs[i].pid = pid;
-            crocs[i].x = 0;
-            crocs[i].y = 0;
-            crocs[i].has_pos = 0;
-            crocs[i].dx_frame = 0;
-            return &crocs[i];
+    croc_lane_set_x(L, p, m->x); // Aggiorna la posizione x del coccodrillo.
+    L->speed[p] = m->x_speed; // Aggiorna la velocità orizzontale del coccodrillo.
+}
+
+static int croc_x_at(const CrocState *c, int x_speed, long long t_us);
+
+// Nascita di un coccodrillo a dead reckoning: da qui in poi il padre calcola x da solo.
+// t_us è l'istante di applicazione (la posizione maturata mentre il record era in coda).
+static void apply_croc_spawn(const msg *m, long long t_us) {
+    CrocState* cs = get_croc_slot(m->pid);
+    int p = cs ? croc_place((int)(cs - crocs), m->y) : -1;
+    if (p < 0) return;
+    CrocLane *L = &croc_lanes[cs->lane];
+    cs->dead_reckoned = 1;
+    cs->x0 = m->x;
+    cs->t0_us = m->t_us;
+    cs->has_pos = 1;
+    L->speed[p] = m->x_speed;
+    croc_lane_set_x(L, p, croc_x_at(cs, m->x_speed, t_us));
+}
+
+// Il coccodrillo è uscito di scena: libera lo slot (se non l'ha già fatto lo sweep)
+static void apply_croc_despawn(const msg *m) {
+    CrocState* cs = croc_from_handle(pid_index_find(&croc_arena.index, m->pid));
+    if (cs) release_croc_slot((int)(cs - crocs));
+}
+
+// Applica un messaggio di posizione OBJ_PROJECTILE (proiettile a processo) al suo slot
+static void apply_projectile_position(const msg *m) {
+    ProjectileState* ps = get_projectile_slot(m->pid);
+    int p = ps ? projectile_place((int)(ps - projectiles), m->y) : -1;
+    if (p < 0) return;
+    ProjectileLane *L = &projectile_lanes[ps->lane];
+    L->id[p] = OBJ_PROJECTILE;
+    // Se è la prima volta che riceviamo un messaggio da questo proiettile,
+    // determina la direzione dal coccodrillo che lo ha sparato
+    if (L->direction[p] == 0) {
+        // Cerca il coccodrillo alla stessa altezza del proiettile (stessa corsia)
+        const CrocLane *C = &croc_lanes[ps->lane];
+        for (int i = 0; i < C->n; i++) {
+            if (C->y[i] == m->y) {
+                // Determina direzione dal movimento del coccodrillo
+                L->direction[p] = (C->speed[i] > 0) ? 1 : -1;
+                break;
+            }
         }
+        if (L->direction[p] == 0) L->direction[p] = 1; // fallback
     }
-    return NULL; // nessuno slot disponibile (caso limite)
+    projectile_lane_set_x(L, p, m->x);
+}
+
+// Processo terminato (record di fine o SIGCHLD): libera lo slot a cui era legato il suo pid
+static void release_exited_pid(pid_t pid) {
+    CrocState* cs = croc_from_handle(pid_index_find(&croc_arena.index, pid));
+    if (cs) release_croc_slot((int)(cs - crocs));
+    ProjectileState* ps = projectile_from_handle(pid_index_find(&projectile_arena.index, pid));
+    if (ps) release_projectile_slot((int)(ps - projectiles));
+}
+
+// Alloca uno slot proiettile libero (NULL se la tabella è piena)
+static ProjectileState* alloc_projectile_slot(pid_t pid) {
+    int i = arena_take_slot(&projectile_arena, projectile_arena_grow);
+    if (i < 0) return NULL; // arena al tetto: aggiornamento contato come perso
+    projectiles[i].in_use = 1;
+    projectiles[i].pid = pid;
+    projectiles[i].lane = -1;   // collocato in una corsia alla prima posizione
+    projectiles[i].analytic = 0;
+    if (pid > 0) pid_index_insert(&projectile_arena.index, pid, make_handle(i, projectile_arena.gen[i]));
+    return &projectiles[i];
 }
 
 static ProjectileState* get_projectile_slot(pid_t pid) {
-    // cerca se esiste già
-    for (int i = 0; i < MAX_PROJECTILES; i++) {
-        if (projectiles[i].in_use && projectiles[i].pid == pid) {
-            return &projectiles[i];
-        }
-    }
+    // cerca se esiste già (indice pid -> handle)
+    EntityHandle h = pid_index_find(&projectile_arena.index, pid);
+    if (h != HANDLE_NONE) return projectile_from_handle(h);
     // altrimenti trova uno slot libero
-    for (int i = 0; i < MAX_PROJECTILES; i++) {
-        if (!projectiles[i].in_use) {
-            projectiles[i].in_use = 1;
-            projectiles[i].pid = pid;
-            projectiles[i].x = 0;
-            projectiles[i].y = 0;
-            projectiles[i].direction = 0;
-            return &projectiles[i];
-        }
-    }
-    return NULL; // nessuno slot disponibile (caso limite)
+    return alloc_projectile_slot(pid);
 }
 
 
@@ -781,27 +1826,879 @@ static int flow_to_y(int flow_index) {
 static int flow_speeds[N_FLUSSI];
 
 // Inizializza velocità orizzontali per ogni flusso con una distribuzione semplice
-static void init_flow_speeds_random(void) {
+static void init_flow_speeds_random(Rng *r) {
     // Distribuzione lenta in generale: più probabile 1, poi 2, raramente 3
     int choices[6] = {1,1,1,2,2,3};
     for (int i = 0; i < N_FLUSSI; i++) {
-        flow_speeds[i] = choices[rand() % 6];
+        flow_speeds[i] = choices[rng_next(r) % 6];
     }
 }
 
-// Tempo corrente in millisecondi (monotonic clock)
-static long long now_ms(void) {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (long long)ts.tv_sec * 1000LL + (long long)ts.tv_nsec / 1000000LL;
+// Posizione di un coccodrillo a dead reckoning all'istante t: stessa progressione
+// a passi discreti del figlio (un passo di x_speed colonne ogni CROC_TICK_US)
+static int croc_x_at(const CrocState *c, int x_speed, long long t_us) {
+    long long steps = (t_us - c->t0_us) / CROC_TICK_US;
+    if (steps < 0) steps = 0;
+    return c->x0 + (int)(steps * x_speed);
 }
 
-// Processo singolo proiettile
-static void projectile_process(int write_fd, int start_x, int start_y, int direction, int msg_id) {
-    close(pipe_fds[0]); // chiude read-end non usata
+// Aggiorna analiticamente tutti i coccodrilli a dead reckoning, accumulando dx_frame per il riding
+static void advance_dead_reckoned_crocs(long long t) {
+    for (int lane = 0; lane < LANE_BUCKETS; lane++) {
+        CrocLane *L = &croc_lanes[lane];
+        for (int p = 0; p < L->n; p++) {
+            const CrocState *c = &crocs[L->slot[p]];
+            if (!c->dead_reckoned) continue;
+            int nx = croc_x_at(c, L->speed[p], t);
+            L->dx_frame[p] += nx - L->x[p];
+            croc_lane_set_x(L, p, nx);
+        }
+    }
+}
 
-    msg m;
+// Crea un proiettile del padre a partire da un evento di sparo (origine, direzione, istante)
+static void spawn_analytic_projectile(int x, int y, int direction, int id, long long t0_us) {
+    ProjectileState* ps = alloc_projectile_slot(-1);
+    if (!ps) return;
+    int p = projectile_place((int)(ps - projectiles), y);
+    if (p < 0) return;
+    ps->analytic = 1;
+    ps->x0 = x;
+    ps->t0_us = t0_us;
+    ProjectileLane *L = &projectile_lanes[ps->lane];
+    L->id[p] = id;
+    L->direction[p] = direction;
+    projectile_lane_set_x(L, p, x);
+}
+
+// Avanza i proiettili del padre: stessa cadenza del vecchio processo (1 colonna ogni PROJECTILE_STEP_US)
+static void advance_analytic_projectiles(long long t) {
+    for (int lane = 0; lane < LANE_BUCKETS; lane++) {
+        ProjectileLane *L = &projectile_lanes[lane];
+        for (int p = 0; p < L->n; p++) {
+            const ProjectileState *ps = &projectiles[L->slot[p]];
+            if (!ps->analytic) continue;
+            long long steps = (t - ps->t0_us) / PROJECTILE_STEP_US;
+            if (steps < 0) steps = 0;
+            projectile_lane_set_x(L, p, ps->x0 + (int)(steps * L->direction[p]));
+        }
+    }
+}
+
+// Da chiamare dopo ogni fork() riuscito: alimenta il contatore condiviso
+static void count_fork(void) {
+    if (shared_stats) atomic_fetch_add_explicit(&shared_stats->forks, 1, memory_order_relaxed);
+}
+
+// --- io_uring (syscall dirette) ---
+
+// Prenota la prossima SQE libera (azzerata); NULL se la coda di invio è piena
+static struct io_uring_sqe *uring_get_sqe(void) {
+    unsigned tail = *uring.sq_tail;
+    if (tail - atomic_load_explicit((_Atomic unsigned *)uring.sq_head, memory_order_acquire) == uring.sq_entries) return NULL;
+    unsigned idx = tail & *uring.sq_mask;
+    struct io_uring_sqe *sqe = &uring.sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    uring.sq_array[idx] = idx;
+    atomic_store_explicit((_Atomic unsigned *)uring.sq_tail, tail + 1, memory_order_release);
+    uring.to_submit++;
+    return sqe;
+}
+
+// Consegna le SQE preparate e, con wait, dorme finché non c'è almeno un completamento
+// (al massimo timeout_us se >= 0). È l'unica syscall del trasporto a regime.
+static void uring_enter(bool wait, long long timeout_us) {
+    unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg = { 0, 0, 0, 0 };
+    void *argp = NULL;
+    size_t argsz = 0;
+    if (wait && timeout_us >= 0) {
+        ts.tv_sec = timeout_us / 1000000LL;
+        ts.tv_nsec = (timeout_us % 1000000LL) * 1000LL;
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        flags |= IORING_ENTER_EXT_ARG;
+        argp = &arg;
+        argsz = sizeof(arg);
+    }
+    long r = syscall(__NR_io_uring_enter, uring.fd, uring.to_submit, wait ? 1 : 0, flags, argp, argsz);
+    frame_recv_syscalls++;
+    if (r > 0) uring.to_submit -= (unsigned)r;
+}
+
+// Read multishot sulla pipe con selezione del buffer dal gruppo 0
+static void uring_arm_read(void) {
+    struct io_uring_sqe *sqe = uring_get_sqe();
+    if (!sqe) return;
+    sqe->opcode = URING_OP_READ_MULTISHOT;
+    sqe->fd = pipe_fds[0];
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->user_data = URING_UD_READ;
+    uring.read_armed = true;
+}
+
+// Scadenza del frame (multishot: un completamento ogni FRAME_US finché non viene rimosso)
+static void uring_arm_tick(void) {
+    struct io_uring_sqe *sqe = uring_get_sqe();
+    if (!sqe) return;
+    uring_tick_ts.tv_sec = 0;
+    uring_tick_ts.tv_nsec = FRAME_US * 1000LL;
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)(uintptr_t)&uring_tick_ts;
+    sqe->len = 1;
+    sqe->timeout_flags = uring.tick_multishot ? URING_TIMEOUT_MULTISHOT : 0;
+    sqe->user_data = URING_UD_TICK;
+    uring.tick_armed = true;
+}
+
+// Risveglio quando il canale input diventa leggibile (poll multishot; lo legge input_recv_batch)
+static void uring_arm_input(void) {
+    struct io_uring_sqe *sqe = uring_get_sqe();
+    if (!sqe || input_fds[0] < 0) return;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = input_fds[0];
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = URING_UD_INPUT;
+    uring.input_armed = true;
+}
+
+// Poll multishot sulla signalfd di SIGCHLD: un'uscita di un figlio diventa un completamento
+static void uring_arm_child(void) {
+    if (child_signal_fd < 0) return;
+    struct io_uring_sqe *sqe = uring_get_sqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = child_signal_fd;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = URING_UD_CHILD;
+    uring.child_armed = true;
+}
+
+// Restituisce al kernel un buffer consumato
+static void uring_recycle(int bid) {
+    struct io_uring_buf *b = &uring.br->bufs[uring.br_tail & (URING_BUFS - 1)];
+    b->addr = (uint64_t)(uintptr_t)(uring.bufs + (size_t)bid * URING_BUF_SIZE);
+    b->len = URING_BUF_SIZE;
+    b->bid = (unsigned short)bid;
+    uring.br_tail++;
+    atomic_store_explicit((_Atomic unsigned short *)&uring.br->tail, uring.br_tail, memory_order_release);
+}
+
+// Raccoglie i completamenti fino al prossimo buffer di messaggi (che diventa quello in
+// consumo). Tick e input vengono solo annotati. Falso se non ci sono dati pronti.
+static bool uring_reap_read(void) {
+    unsigned head = *uring.cq_head;
+    bool got = false;
+    while (!got && head != atomic_load_explicit((_Atomic unsigned *)uring.cq_tail, memory_order_acquire)) {
+        struct io_uring_cqe *cqe = &uring.cqes[head & *uring.cq_mask];
+        bool more = cqe->flags & IORING_CQE_F_MORE;
+        switch (cqe->user_data) {
+        case URING_UD_READ:
+            if (!more) uring.read_armed = false; // buffer finiti (-ENOBUFS) o errore: si riarma
+            if (cqe->res > 0) {
+                uring.cur_bid = (int)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+                uring.cur_off = 0;
+                uring.cur_len = (size_t)cqe->res;
+                got = true;
+            } else if (cqe->res == 0) {
+                uring.eof = true;
+            }
+            break;
+        case URING_UD_TICK:
+            if (cqe->res == -EINVAL && uring.tick_multishot) {
+                uring.tick_multishot = false; // kernel senza timeout multishot: uno per frame
+            } else {
+                uring.tick = true;
+            }
+            if (!more) uring.tick_armed = false;
+            break;
+        case URING_UD_INPUT:
+            uring.input = true;
+            if (!more) uring.input_armed = false;
+            break;
+        case URING_UD_CHILD:
+            children_exited = true;
+            if (!more) uring.child_armed = false;
+            break;
+        }
+        head++;
+    }
+    atomic_store_explicit((_Atomic unsigned *)uring.cq_head, head, memory_order_release);
+    return got;
+}
+
+// Stessa semantica di transport_recv_batch() sulla pipe, ma i byte arrivano dai buffer
+// già riempiti dal kernel: nessuna syscall finché la read multishot resta armata
+static int uring_recv_batch(msg *out, int max) {
+    unsigned char *dst = (unsigned char *)out;
+    size_t want = (size_t)max * sizeof(msg);
+    size_t have = pipe_carry_len;
+    memcpy(dst, pipe_carry, have);
+    while (have < want) {
+        if (uring.cur_len == 0 && !uring_reap_read()) break;
+        size_t take = uring.cur_len < want - have ? uring.cur_len : want - have;
+        memcpy(dst + have, uring.bufs + (size_t)uring.cur_bid * URING_BUF_SIZE + uring.cur_off, take);
+        have += take;
+        uring.cur_off += take;
+        uring.cur_len -= take;
+        if (uring.cur_len == 0) uring_recycle(uring.cur_bid);
+    }
+    if (!uring.read_armed && !uring.eof) {
+        uring_arm_read();                   // caso raro: tutti i buffer erano occupati
+        uring_enter(false, -1);
+    }
+    int n = (int)(have / sizeof(msg));
+    pipe_carry_len = have % sizeof(msg);
+    memcpy(pipe_carry, dst + (size_t)n * sizeof(msg), pipe_carry_len);
+    if (n == 0 && uring.eof) {
+        errno = 0;
+        return -1;
+    }
+    frame_recv_msgs += n;
+    return n;
+}
+
+static void uring_close(void) {
+    if (uring.fd < 0) return;
+    close(uring.fd);
+    if (uring.ring_mem) munmap(uring.ring_mem, uring.ring_sz);
+    if (uring.sqes) munmap(uring.sqes, uring.sqes_sz);
+    if (uring.br) munmap(uring.br, (size_t)URING_BUFS * sizeof(struct io_uring_buf));
+    free(uring.bufs);
+    uring = (Uring){ .fd = -1 };
+}
+
+// Crea l'anello, registra i buffer e arma la read multishot sulla pipe.
+// -1 (errno impostato) se il kernel non lo permette: il chiamante torna alla pipe.
+static int uring_open(void) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    uring = (Uring){ .fd = -1, .tick_multishot = true };
+    int fd = (int)syscall(__NR_io_uring_setup, URING_ENTRIES, &p);
+    if (fd < 0) return -1;
+    uring.fd = fd;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+        uring_close();
+        errno = ENOSYS;
+        return -1;
+    }
+    // Il probe dice se questo kernel conosce la read multishot
+    size_t probe_sz = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, probe_sz);
+    bool mshot = probe && syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0 &&
+                 probe->last_op >= URING_OP_READ_MULTISHOT &&
+                 (probe->ops[URING_OP_READ_MULTISHOT].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    if (!mshot) {
+        uring_close();
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+
+    size_t sq_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    uring.ring_sz = sq_sz > cq_sz ? sq_sz : cq_sz;
+    uring.sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+    void *ring = mmap(NULL, uring.ring_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    void *sqes = mmap(NULL, uring.sqes_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    void *br = mmap(NULL, (size_t)URING_BUFS * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    uring.ring_mem = ring == MAP_FAILED ? NULL : ring;
+    uring.sqes = sqes == MAP_FAILED ? NULL : sqes;
+    uring.br = br == MAP_FAILED ? NULL : br;
+    uring.bufs = malloc((size_t)URING_BUFS * URING_BUF_SIZE);
+    if (!uring.ring_mem || !uring.sqes || !uring.br || !uring.bufs) {
+        uring_close();
+        errno = ENOMEM;
+        return -1;
+    }
+    unsigned char *r = uring.ring_mem;
+    uring.sq_head = (unsigned *)(r + p.sq_off.head);
+    uring.sq_tail = (unsigned *)(r + p.sq_off.tail);
+    uring.sq_mask = (unsigned *)(r + p.sq_off.ring_mask);
+    uring.sq_array = (unsigned *)(r + p.sq_off.array);
+    uring.sq_entries = p.sq_entries;
+    uring.cq_head = (unsigned *)(r + p.cq_off.head);
+    uring.cq_tail = (unsigned *)(r + p.cq_off.tail);
+    uring.cq_mask = (unsigned *)(r + p.cq_off.ring_mask);
+    uring.cqes = (struct io_uring_cqe *)(r + p.cq_off.cqes);
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)uring.br;
+    reg.ring_entries = URING_BUFS;
+    reg.bgid = 0;
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        int e = errno;
+        uring_close();
+        errno = e;
+        return -1;
+    }
+    for (int b = 0; b < URING_BUFS; b++) uring_recycle(b);
+    uring_arm_read();
+    uring_enter(false, -1);
+    return 0;
+}
+
+// Nel figlio il pid in cache è quello del padre: va riletto al primo invio
+static void shm_after_fork(void) {
+    shm_self_pid = 0;
+}
+
+// Crea il canale figli -> padre prima dei fork: la pipe esiste sempre,
+// il ring condiviso e l'eventfd solo se è stato scelto il trasporto shm.
+// A parte, una pipe riservata agli input della rana.
+static int transport_open(void) {
+    if (pipe(pipe_fds) == -1) return -1;
+    pipe_carry_len = 0;
+    // Il kernel arrotonda a pagine; oltre /proc/sys/fs/pipe-max-size serve CAP_SYS_RESOURCE
+    if (pipe_size_req > 0 && fcntl(pipe_fds[0], F_SETPIPE_SZ, pipe_size_req) == -1) pipe_size_errno = errno;
+    pipe_capacity = fcntl(pipe_fds[0], F_GETPIPE_SZ);
+    if (pipe(input_fds) == -1) return -1;
+    fcntl(input_fds[0], F_SETFL, fcntl(input_fds[0], F_GETFL, 0) | O_NONBLOCK);
+    if (transport_mode == TRANSPORT_URING && uring_open() == -1) {
+        uring_fallback_errno = errno;       // io_uring non disponibile: si resta sulla read() classica
+        transport_mode = TRANSPORT_PIPE;
+    }
+    if (transport_mode != TRANSPORT_SHM) return 0;
+
+    void *mem = mmap(NULL, sizeof(ShmRing), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return -1;
+    shm_ring = (ShmRing *)mem;
+    atomic_init(&shm_ring->head, 0);
+    atomic_init(&shm_ring->tail, 0);
+    atomic_init(&shm_ring->sleeping, 0);
+    for (unsigned i = 0; i < SHM_RING_CAP; i++) {
+        atomic_init(&shm_ring->cells[i].seq, i); // cella i libera per il primo giro
+        atomic_init(&shm_ring->cells[i].owner, 0);
+    }
+    static bool atfork_set = false;
+    if (!atfork_set) {
+        pthread_atfork(NULL, NULL, shm_after_fork);
+        atfork_set = true;
+    }
+    shm_event_fd = eventfd(0, EFD_NONBLOCK);
+    if (shm_event_fd == -1) return -1;
+    shm_stuck_since_ms = -1;
+    return 0;
+}
+
+// Rilascia ring, eventfd, io_uring e canale input (la pipe viene chiusa da cleanup_pipes)
+static void transport_close(void) {
+    uring_close();
+    for (int k = 0; k < 2; k++) {
+        if (input_fds[k] >= 0) {
+            close(input_fds[k]);
+            input_fds[k] = -1;
+        }
+    }
+    if (shm_ring) {
+        munmap(shm_ring, sizeof(ShmRing));
+        shm_ring = NULL;
+    }
+    if (shm_event_fd >= 0) {
+        close(shm_event_fd);
+        shm_event_fd = -1;
+    }
+}
+
+// Invia un messaggio al padre. Stessa semantica di write(): con il ring pieno
+// restituisce -1 ed errno = EAGAIN, così i chiamanti non cambiano logica.
+static ssize_t transport_send(int write_fd, const msg *m) {
+    if (transport_mode != TRANSPORT_SHM || !shm_ring) {
+        ssize_t wr = write(write_fd, m, sizeof(*m));
+        if (wr > 0 && shared_stats) atomic_fetch_add_explicit(&shared_stats->msgs_sent, 1, memory_order_relaxed);
+        return wr;
+    }
+    ShmRing *r = shm_ring;
+    if (shm_self_pid == 0) shm_self_pid = getpid();
+    unsigned pos = atomic_load_explicit(&r->head, memory_order_relaxed);
+    RingCell *c;
+    int spins = 0;
+    for (;;) {
+        c = &r->cells[pos & (SHM_RING_CAP - 1)];
+        unsigned seq = atomic_load_explicit(&c->seq, memory_order_acquire);
+        int diff = (int)(seq - pos);
+        if (diff == 0) {
+            // Cella libera per questo giro: la prenotazione parte dalla firma (owner 0 -> pid),
+            // poi head. Così ogni cella prenotata ha già il pid che il padre può controllare.
+            int free_owner = 0;
+            if (atomic_compare_exchange_strong(&c->owner, &free_owner, shm_self_pid)) {
+                unsigned expected = pos;
+                if (atomic_compare_exchange_strong(&r->head, &expected, pos + 1)) break;
+                atomic_store(&c->owner, 0);     // head già oltre: giro vecchio, rinuncia
+                pos = expected;
+            } else if (++spins > SHM_SEND_SPINS) {
+                errno = EAGAIN;                 // firmata da un produttore che non avanza head
+                return -1;
+            } else {
+                pos = atomic_load_explicit(&r->head, memory_order_relaxed);
+            }
+        } else if (diff < 0) {
+            errno = EAGAIN;                 // ring pieno: il padre è indietro
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&r->head, memory_order_relaxed); // altro produttore più veloce
+        }
+    }
+    c->m = *m;
+    // Pubblica con CAS: se il padre ha già dato la cella per persa, il messaggio è scartato
+    unsigned expected = pos;
+    if (!atomic_compare_exchange_strong(&c->seq, &expected, pos + 1)) {
+        errno = EAGAIN;
+        return -1;
+    }
+    // Risveglia il padre solo se sta effettivamente aspettando
+    if (atomic_load(&r->sleeping) && atomic_exchange(&r->sleeping, 0)) {
+        uint64_t one = 1;
+        ssize_t wr = write(shm_event_fd, &one, sizeof(one));
+        (void)wr;
+    }
+    if (shared_stats) atomic_fetch_add_explicit(&shared_stats->msgs_sent, 1, memory_order_relaxed);
+    return (ssize_t)sizeof(*m);
+}
+
+// Invio con controllo di flusso dal processo produttore kind. Una posizione (essential
+// falso) a canale pieno viene saltata subito: il padre riceverà la successiva. Un evento
+// viene ritentato finché non passa: una nascita persa lascerebbe il coccodrillo invisibile
+// per tutta la traversata, un'uscita persa lo lascerebbe nell'arena. Restituisce 0 se
+// consegnato, -1 se la posizione è stata saltata o il padre ha chiuso il canale.
+static int producer_send(int kind, int write_fd, const msg *m, bool essential) {
+    ProducerStats *ps = shared_stats ? &shared_stats->producers[kind] : NULL;
+    for (;;) {
+        if (transport_send(write_fd, m) > 0) {
+            if (ps) atomic_fetch_add_explicit(&ps->sent, 1, memory_order_relaxed);
+            return 0;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) return -1; // padre chiuso
+        if (!essential) {
+            if (ps) atomic_fetch_add_explicit(&ps->dropped, 1, memory_order_relaxed);
+            return -1;
+        }
+        if (ps) atomic_fetch_add_explicit(&ps->retried, 1, memory_order_relaxed);
+        usleep(PRODUCER_RETRY_US);
+    }
+}
+
+// Riceve un messaggio (lato padre). Stessa semantica di read() su pipe non bloccante.
+static ssize_t transport_recv(msg *out) {
+    if (transport_mode != TRANSPORT_SHM || !shm_ring) {
+        return read(pipe_fds[0], out, sizeof(*out));
+    }
+    ShmRing *r = shm_ring;
+    for (;;) {
+        unsigned pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+        RingCell *c = &r->cells[pos & (SHM_RING_CAP - 1)];
+        unsigned seq = atomic_load_explicit(&c->seq, memory_order_acquire);
+        if (seq == pos + 1) {
+            *out = c->m;
+            atomic_store_explicit(&c->owner, 0, memory_order_relaxed);
+            atomic_store_explicit(&c->seq, pos + SHM_RING_CAP, memory_order_release); // libera per il giro dopo
+            atomic_store_explicit(&r->tail, pos + 1, memory_order_relaxed);
+            shm_stuck_since_ms = -1;
+            return (ssize_t)sizeof(*out);
+        }
+        // Cella firmata ma non pubblicata. Un produttore solo lento (prelazione) la
+        // pubblicherà: saltarla perderebbe il messaggio e lui scriverebbe poi su una cella
+        // già riusata. La saltiamo solo se il produttore che l'ha firmata non esiste più
+        // (ucciso con SIGKILL a metà invio e già raccolto), controllando ogni SHM_STUCK_MS.
+        pid_t owner = (seq == pos) ? atomic_load(&c->owner) : 0;
+        if (owner > 0) {
+            long long t = now_ms();
+            if (shm_stuck_since_ms < 0) {
+                shm_stuck_since_ms = t;
+            } else if (t - shm_stuck_since_ms >= SHM_STUCK_MS) {
+                shm_stuck_since_ms = t;
+                if (kill(owner, 0) == -1 && errno == ESRCH) {
+                    unsigned expected = pos;
+                    if (atomic_compare_exchange_strong(&c->seq, &expected, pos + SHM_RING_CAP)) {
+                        // Morto tra firma e head: head avanza qui, poi la firma si libera
+                        expected = pos;
+                        atomic_compare_exchange_strong(&r->head, &expected, pos + 1);
+                        atomic_store(&c->owner, 0);
+                        atomic_store_explicit(&r->tail, pos + 1, memory_order_relaxed);
+                        stat_shm_skipped++;
+                    }
+                    shm_stuck_since_ms = -1;
+                    continue;
+                }
+            }
+        }
+        errno = EAGAIN;
+        return -1;
+    }
+}
+
+// Drena in un colpo solo i messaggi disponibili (al massimo max) dentro out[].
+// Con la pipe è una sola read() grande: l'eventuale record troncato in coda resta
+// in pipe_carry e viene completato alla lettura successiva.
+// Restituisce il numero di messaggi, 0 se non c'è nulla, -1 se la pipe è chiusa
+// (errno = 0) o in errore.
+static int transport_recv_batch(msg *out, int max) {
+    if (transport_mode == TRANSPORT_URING) return uring_recv_batch(out, max);
+    if (transport_mode == TRANSPORT_SHM && shm_ring) {
+        int n = 0;
+        while (n < max && transport_recv(&out[n]) > 0) n++;
+        frame_recv_msgs += n;
+        return n;
+    }
+
+    unsigned char *buf = (unsigned char *)out;
+    size_t have = pipe_carry_len;
+    memcpy(buf, pipe_carry, have);           // rimette in testa il record incompleto
+    ssize_t rd = read(pipe_fds[0], buf + have, (size_t)max * sizeof(msg) - have);
+    frame_recv_syscalls++;
+    if (rd == 0) {
+        errno = 0;
+        return -1;
+    }
+    if (rd < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+    size_t total = have + (size_t)rd;
+    int n = (int)(total / sizeof(msg));
+    pipe_carry_len = total % sizeof(msg);
+    memcpy(pipe_carry, buf + (size_t)n * sizeof(msg), pipe_carry_len);
+    frame_recv_msgs += n;
+    return n;
+}
+
+// Campiona i byte in attesa nella pipe (inizio frame): grafico, high-water mark, decili
+static void pipe_sample_occupancy(void) {
+    int bytes = 0;
+    if (transport_mode == TRANSPORT_SHM || ioctl(pipe_fds[0], FIONREAD, &bytes) == -1) return;
+    frame_pipe_bytes = bytes;
+    stat_pipe_samples++;
+    stat_pipe_bytes_sum += bytes;
+    if (bytes > stat_pipe_hwm) stat_pipe_hwm = bytes;
+    if (pipe_capacity > 0) {
+        int b = (int)((long long)bytes * PIPE_HIST_BUCKETS / pipe_capacity);
+        stat_pipe_hist[b < PIPE_HIST_BUCKETS ? b : PIPE_HIST_BUCKETS - 1]++;
+    }
+    if (pipe_spark_frames == PIPE_SPARK_FRAMES) {
+        memmove(pipe_spark, pipe_spark + 1, (PIPE_SPARK_CELLS - 1) * sizeof(int));
+        pipe_spark[PIPE_SPARK_CELLS - 1] = 0;
+        pipe_spark_frames = 0;
+    }
+    if (bytes > pipe_spark[PIPE_SPARK_CELLS - 1]) pipe_spark[PIPE_SPARK_CELLS - 1] = bytes;
+    pipe_spark_frames++;
+}
+
+// Attende (al massimo timeout_ms) che arrivi almeno un messaggio
+static void transport_wait(int timeout_ms) {
+    if (transport_mode == TRANSPORT_URING) {
+        if (uring.cur_len == 0 && *uring.cq_head == atomic_load((_Atomic unsigned *)uring.cq_tail)) {
+            uring_enter(true, timeout_ms * 1000LL);
+        }
+        return;
+    }
+    if (transport_mode != TRANSPORT_SHM || !shm_ring) {
+        struct pollfd p = { .fd = pipe_fds[0], .events = POLLIN, .revents = 0 };
+        poll(&p, 1, timeout_ms);
+        return;
+    }
+    atomic_store(&shm_ring->sleeping, 1);
+    // Ricontrolla dopo aver alzato il flag: un produttore potrebbe aver appena pubblicato
+    unsigned pos = atomic_load(&shm_ring->tail);
+    if (atomic_load(&shm_ring->cells[pos & (SHM_RING_CAP - 1)].seq) != pos + 1) {
+        struct pollfd p = { .fd = shm_event_fd, .events = POLLIN, .revents = 0 };
+        if (poll(&p, 1, timeout_ms) > 0) {
+            uint64_t v;
+            ssize_t rd = read(shm_event_fd, &v, sizeof(v));
+            (void)rd;
+        }
+    }
+    atomic_store(&shm_ring->sleeping, 0);
+}
+
+// Invio dalla rana sul canale input: write() di un record (atomica, < PIPE_BUF)
+static ssize_t input_send(int write_fd, msg *m) {
+    m->t_us = now_us();                     // istante di invio: ritardo di coda misurato dal padre
+    ssize_t wr = write(write_fd, m, sizeof(*m));
+    if (wr > 0 && shared_stats) {
+        atomic_fetch_add_explicit(&shared_stats->msgs_sent, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&shared_stats->producers[PRODUCER_FROG].sent, 1, memory_order_relaxed);
+    }
+    return wr;
+}
+
+// Drena il canale input (al massimo max record) e registra il ritardo di coda di ciascuno
+static int input_recv_batch(msg *out, int max) {
+    if (input_fds[0] < 0) return 0;
+    ssize_t rd = read(input_fds[0], out, (size_t)max * sizeof(msg));
+    if (rd <= 0) return 0;
+    int n = (int)(rd / (ssize_t)sizeof(msg)); // write atomiche di un record: niente code tronche
+    long long t = now_us();
+    for (int k = 0; k < n; k++) {
+        input_delay_us[input_delay_n % INPUT_DELAY_SAMPLES] = t - out[k].t_us;
+        input_delay_n++;
+    }
+    return n;
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+// Percentile (0-100) dei ritardi di coda raccolti, in microsecondi
+static long long input_delay_percentile(int pct) {
+    int n = (int)(input_delay_n < INPUT_DELAY_SAMPLES ? input_delay_n : INPUT_DELAY_SAMPLES);
+    if (n == 0) return 0;
+    static long long sorted[INPUT_DELAY_SAMPLES];
+    memcpy(sorted, input_delay_us, (size_t)n * sizeof(long long));
+    qsort(sorted, (size_t)n, sizeof(long long), cmp_ll);
+    int idx = (int)((long long)n * pct / 100);
+    return sorted[idx < n ? idx : n - 1];
+}
+
+// Messaggio generato da un tasto della rana (solo la rana timbra t_us su questi id)
+static bool is_frog_input(const msg *m) {
+    return m->t_us > 0 && (m->id == OBJ_RANA || m->id == OBJ_TELEPORT || m->id == OBJ_GRENADE || m->id == OBJ_QUIT);
+}
+
+// Aggiornamento di posizione di un coccodrillo o di un proiettile/granata a processo
+static bool is_position_msg(const msg *m) {
+    return m->id == OBJ_CROC || m->id == OBJ_PROJECTILE || (m->id == OBJ_GRENADE && !is_frog_input(m));
+}
+
+// Coalescenza last-writer-wins: marca in skip[] gli aggiornamenti di posizione superati da
+// uno successivo dello stesso pid nello stesso batch. Basta applicare l'ultimo: x, y e
+// velocità vengono sovrascritte e dx_frame si accumula come differenza tra l'ultima x e
+// quella del frame precedente, cioè la somma dei delta intermedi. Il primo aggiornamento di
+// un pid non ancora noto al padre non viene scartato (fissa la posizione di partenza del
+// delta, come senza coalescenza). Restituisce quanti aggiornamenti sono stati marcati.
+static int coalesce_positions(const msg *batch, int n, bool *skip) {
+    static pid_t keys[COALESCE_BUCKETS];
+    static int last[COALESCE_BUCKETS];      // indice nel batch dell'ultimo aggiornamento del pid
+    static bool anchor[COALESCE_BUCKETS];   // last è il primo aggiornamento di un pid nuovo
+    static unsigned stamp[COALESCE_BUCKETS];
+    static unsigned gen = 0;
+    gen++;                                  // svuota la tabella senza azzerarla
+
+    int skipped = 0;
+    for (int k = 0; k < n; k++) {
+        skip[k] = false;
+        const msg *m = &batch[k];
+        if (!is_position_msg(m) || (m->pid <= 0 && !is_lane_croc_id(m->pid))) continue;
+        unsigned b = ((unsigned)m->pid * 2654435761u) & (COALESCE_BUCKETS - 1);
+        while (stamp[b] == gen && keys[b] != m->pid) b = (b + 1) & (COALESCE_BUCKETS - 1);
+        if (stamp[b] != gen) {
+            const PidIndex *ix = (m->id == OBJ_CROC) ? &croc_arena.index : &projectile_arena.index;
+            stamp[b] = gen;
+            keys[b] = m->pid;
+            anchor[b] = (pid_index_find(ix, m->pid) == HANDLE_NONE);
+        } else if (batch[last[b]].id == m->id) {
+            if (anchor[b]) {
+                anchor[b] = false;          // il primo resta, i successivi si coalescono
+            } else {
+                skip[last[b]] = true;
+                skipped++;
+            }
+        }
+        last[b] = k;
+    }
+    return skipped;
+}
+
+// SIGCHLD come evento: bloccato e letto da una signalfd sorvegliata dal ciclo a eventi, così
+// waitpid si chiama solo dopo un'uscita. Va aperta prima delle fork: i figli ereditano la
+// maschera, che non li tocca (raccolgono i loro figli con waitpid). Se fallisce: polling.
+static void child_events_open(void) {
+    if (reap_mode != REAP_SIGNALFD || child_signal_fd >= 0) return;
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) == -1 ||
+        (child_signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC)) == -1) {
+        sigprocmask(SIG_UNBLOCK, &mask, NULL);
+        reap_mode = REAP_POLL;
+    }
+}
+
+static void child_events_close(void) {
+    if (child_signal_fd < 0) return;
+    close(child_signal_fd);
+    child_signal_fd = -1;
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_UNBLOCK, &mask, NULL);
+}
+
+// Svuota la signalfd (i SIGCHLD ravvicinati si fondono: conta solo che ne sia arrivato uno)
+static void child_events_drain(void) {
+    struct signalfd_siginfo si[8];
+    for (;;) {
+        stat_liveness_syscalls++;
+        ssize_t rd = read(child_signal_fd, si, sizeof(si));
+        if (rd <= 0) break;
+        children_exited = true;
+        if (rd < (ssize_t)sizeof(si)) break;
+    }
+}
+
+// Raccoglie i figli del padre terminati e libera gli slot legati ai loro pid. Con la signalfd
+// nessuna syscall finché non arriva SIGCHLD (con --loop=sleep una lettura per frame).
+static void reap_children(void) {
+    if (reap_mode == REAP_SIGNALFD) {
+        if (children_exited || loop_mode != LOOP_EPOLL) child_events_drain(); // riarma il poll
+        if (!children_exited) return;
+        children_exited = false;
+    }
+    for (;;) {
+        stat_liveness_syscalls++;
+        pid_t pid = waitpid(-1, NULL, WNOHANG);
+        if (pid <= 0) break;
+        stat_children_reaped++;
+        release_exited_pid(pid);
+    }
+}
+
+// Registra in epoll il canale messaggi corrente (da ripetere se il trasporto viene ricreato)
+static void loop_watch_transport(void) {
+    if (transport_mode == TRANSPORT_URING) {
+        // Con io_uring niente epoll: scadenza del frame e canale input sono SQE dello stesso anello
+        if (loop_mode != LOOP_EPOLL) return;
+        uring_arm_tick();
+        uring_arm_input();
+        uring_arm_child();
+        uring_enter(false, -1);
+        pending_n = 0;
+        return;
+    }
+    if (loop_epoll_fd < 0) return;
+    if (loop_msg_fd >= 0) epoll_ctl(loop_epoll_fd, EPOLL_CTL_DEL, loop_msg_fd, NULL); // può essere già chiuso
+    if (loop_input_fd >= 0) epoll_ctl(loop_epoll_fd, EPOLL_CTL_DEL, loop_input_fd, NULL);
+    loop_msg_fd = (transport_mode == TRANSPORT_SHM && shm_ring) ? shm_event_fd : pipe_fds[0];
+    loop_input_fd = input_fds[0];
+    struct epoll_event ev = { .events = EPOLLIN, .data.fd = loop_msg_fd };
+    epoll_ctl(loop_epoll_fd, EPOLL_CTL_ADD, loop_msg_fd, &ev);
+    ev.data.fd = loop_input_fd;
+    epoll_ctl(loop_epoll_fd, EPOLL_CTL_ADD, loop_input_fd, &ev);
+    pending_n = 0;                          // eventuali messaggi dei figli precedenti
+}
+
+// Prepara il ciclo a eventi: epoll sul canale messaggi e un timerfd periodico a FRAME_US.
+// Se qualcosa fallisce si resta sul ciclo con napms().
+static void loop_open(void) {
+    if (loop_mode != LOOP_EPOLL) return;
+    if (transport_mode == TRANSPORT_URING) {
+        loop_watch_transport();
+        return;
+    }
+    loop_epoll_fd = epoll_create1(0);
+    loop_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    struct itimerspec its = { { 0, FRAME_US * 1000L }, { 0, FRAME_US * 1000L } };
+    if (loop_epoll_fd < 0 || loop_timer_fd < 0 || timerfd_settime(loop_timer_fd, 0, &its, NULL) == -1) {
+        if (loop_epoll_fd >= 0) close(loop_epoll_fd);
+        if (loop_timer_fd >= 0) close(loop_timer_fd);
+        loop_epoll_fd = loop_timer_fd = -1;
+        loop_mode = LOOP_SLEEP;
+        return;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.fd = loop_timer_fd };
+    epoll_ctl(loop_epoll_fd, EPOLL_CTL_ADD, loop_timer_fd, &ev);
+    if (child_signal_fd >= 0) {
+        ev.data.fd = child_signal_fd;
+        epoll_ctl(loop_epoll_fd, EPOLL_CTL_ADD, child_signal_fd, &ev);
+    }
+    loop_watch_transport();
+}
+
+static void loop_close(void) {
+    if (loop_epoll_fd >= 0) close(loop_epoll_fd);
+    if (loop_timer_fd >= 0) close(loop_timer_fd);
+    loop_epoll_fd = loop_timer_fd = loop_msg_fd = loop_input_fd = -1;
+}
+
+// Attesa tra due frame. I messaggi vengono drenati appena arrivano (in pending_msgs, smistati
+// dal frame successivo); si esce alla scadenza del timerfd oppure subito se il canale input
+// è pronto, così il tasto va a schermo senza aspettare il resto del frame.
+static void loop_wait_frame(void) {
+    if (loop_mode != LOOP_EPOLL) {
+        napms(FRAME_US / 1000);
+        return;
+    }
+    if (transport_mode == TRANSPORT_URING) {
+        // I completamenti si raccolgono dalla memoria condivisa; si entra nel kernel
+        // solo per dormire quando non c'è niente di pronto
+        for (;;) {
+            int got = transport_recv_batch(pending_msgs + pending_n, MAX_MSGS_PER_FRAME - pending_n);
+            if (got < 0) return;
+            stat_msgs_recv += got;
+            pending_n += got;
+            bool ready = uring.tick || uring.input || pending_n == MAX_MSGS_PER_FRAME;
+            if (ready) uring.tick = uring.input = false;
+            if (!uring.tick_armed) uring_arm_tick();   // timeout a colpo singolo, o rifiutato
+            if (!uring.input_armed) uring_arm_input();
+            if (!uring.child_armed) uring_arm_child();
+            if (ready) {
+                if (uring.to_submit) uring_enter(false, -1);
+                return;
+            }
+            uring_enter(true, -1);
+        }
+    }
+    bool ring = (transport_mode == TRANSPORT_SHM && shm_ring);
+    for (;;) {
+        int timeout = -1;
+        if (ring) {
+            // Come transport_wait(): flag prima, poi ricontrollo, poi si dorme
+            atomic_store(&shm_ring->sleeping, 1);
+            unsigned pos = atomic_load(&shm_ring->tail);
+            if (atomic_load(&shm_ring->cells[pos & (SHM_RING_CAP - 1)].seq) == pos + 1) timeout = 0;
+        }
+        struct epoll_event evs[4];
+        int n = epoll_wait(loop_epoll_fd, evs, 4, timeout);
+        if (ring) atomic_store(&shm_ring->sleeping, 0);
+        if (n < 0 && errno != EINTR) return;
+
+        bool tick = false;
+        bool input = false;
+        bool drain = (ring && timeout == 0);
+        for (int k = 0; k < n; k++) {
+            if (evs[k].data.fd == loop_input_fd) {
+                input = true;               // lo drena il frame, per primo
+            } else if (evs[k].data.fd == child_signal_fd) {
+                child_events_drain();       // svuotata subito (epoll è a livello), raccolta al frame
+            } else if (evs[k].data.fd == loop_timer_fd) {
+                uint64_t expirations;
+                ssize_t rd = read(loop_timer_fd, &expirations, sizeof(expirations));
+                (void)rd;
+                tick = true;
+            } else {
+                if (ring) {
+                    uint64_t v;
+                    ssize_t rd = read(shm_event_fd, &v, sizeof(v));
+                    (void)rd;
+                }
+                drain = true;
+            }
+        }
+        if (drain) {
+            int got = transport_recv_batch(pending_msgs + pending_n, MAX_MSGS_PER_FRAME - pending_n);
+            if (got < 0) return;            // canale chiuso: lo rileva il drenaggio del frame
+            stat_msgs_recv += got;
+            pending_n += got;
+        }
+        // Con pending pieno si anticipa il frame (altrimenti l'fd resterebbe sempre pronto)
+        if (tick || input || pending_n == MAX_MSGS_PER_FRAME) return;
+    }
+}
+
+#if PROJECTILE_PROCESSES
+// Processo singolo proiettile
+static void projectile_process(int write_fd, int start_x, int start_y, int direction, int msg_id) {
+    close(pipe_fds[0]); // chiude read-end non usata
+
+    msg m;
     m.id = msg_id;                  // può essere OBJ_PROJECTILE o OBJ_GRENADE
+    m.t_us = 0;
     m.pid = getpid();
     m.x_speed = direction;          // comunica al padre la direzione
 
@@ -810,10 +2707,8 @@ static void projectile_process(int write_fd, int start_x, int start_y, int direc
     int left_edge = 1;
     int right_edge = GAME_WIDTH - 2;
 
-    // imposta write non-bloccante per evitare blocchi se la pipe è piena
-    int wfl = fcntl(write_fd, F_GETFL, 0);
-    if (wfl != -1) fcntl(write_fd, F_SETFL, wfl | O_NONBLOCK);
-
+    // La write-end è già non bloccante (impostata dal creatore): a pipe piena la
+    // posizione viene saltata e il proiettile avanza comunque, senza fermarsi
     while (1) {
         // Non inviare coordinate fuori schermo: consenti l'ultima colonna visibile (x == right_edge)
         if (x < left_edge || x > right_edge) {
@@ -822,32 +2717,77 @@ static void projectile_process(int write_fd, int start_x, int start_y, int direc
 
         m.x = x;
         m.y = y;
-        ssize_t wr = write(write_fd, &m, sizeof(m));
-        if (wr < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                usleep(2000);
-                continue;
-            } else {
-                break;
-            }
+        if (producer_send(PRODUCER_PROJECTILE, write_fd, &m, false) < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            break;                  // padre chiuso
         }
 
         x += direction; // proiettili si muovono solo orizzontalmente
 
-        usleep(50000); // movimento più veloce dei coccodrilli
+        usleep(PROJECTILE_STEP_US); // movimento più veloce dei coccodrilli
     }
 
+    // Fine vita annunciata: il padre libera lo slot senza sondare il processo
+    m.id = OBJ_PROJECTILE_GONE;
+    producer_send(PRODUCER_PROJECTILE, write_fd, &m, true);
     close(write_fd);
     _exit(0);
 }
+#endif
 
 // Rimossa la funzione grenade_process - le granate sono gestite direttamente dal padre
 
-// Processo singolo coccodrillo: invia posizioni assolute (come in frogger_ultimate)
-// Processo figlio: muove un singolo coccodrillo e invia posizioni assolute al padre
-static void croc_process(int write_fd, int flow_index) {
-    // il figlio coccodrillo non usa il lato di lettura della pipe
-    close(pipe_fds[0]);                                // chiude la read-end (non serve qui)
+// Latenza di spawn: dall'assegnazione (t_assign) al primo messaggio consegnato al padre
+static void record_spawn_latency(long long t_assign) {
+    if (!shared_stats) return;
+    long long lat = now_us() - t_assign;
+    atomic_fetch_add_explicit(&shared_stats->spawns, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&shared_stats->spawn_lat_sum, lat, memory_order_relaxed);
+    long long cur = atomic_load_explicit(&shared_stats->spawn_lat_max, memory_order_relaxed);
+    while (lat > cur && !atomic_compare_exchange_weak(&shared_stats->spawn_lat_max, &cur, lat)) {}
+}
+
+// Piano di spawn del creatore: flussi, attese e spari vengono da un Rng proprio, così a parità
+// di seme (--seed=N) il processo creatore e la simulazione locale seguono la stessa sequenza
+typedef struct {
+    Rng rng;
+    int last[3];                                       // ultimi tre flussi usati (-1 = nessuno)
+} SpawnPlan;
+
+static void spawn_plan_init(SpawnPlan *sp, uint64_t seed) {
+    rng_seed(&sp->rng, seed);
+    init_flussi(&sp->rng);                             // imposta direzioni dei flussi
+    init_flow_speeds_random(&sp->rng);                 // imposta velocità iniziali dei flussi
+    sp->last[0] = sp->last[1] = sp->last[2] = -1;
+}
+
+// Prossima decisione del creatore: il flusso da far partire (-1 se ripete uno degli ultimi tre)
+// e in *wait_us l'attesa prima della decisione successiva; *croc_rng guida gli spari del nuovo
+static int spawn_plan_next(SpawnPlan *sp, long long *wait_us, Rng *croc_rng) {
+    int flow = (int)(rng_next(&sp->rng) % N_FLUSSI);
+    if (flow == sp->last[0] || flow == sp->last[1] || flow == sp->last[2]) {
+        *wait_us = spawn_interval_ms > 0 ? spawn_interval_ms * 1000LL : CREATOR_SLEEP_US;
+        return -1;
+    }
+    // Aggiorna la memoria dei flussi usati: sposta indietro la storia
+    sp->last[2] = sp->last[1];
+    sp->last[1] = sp->last[0];
+    sp->last[0] = flow;
+    rng_seed(croc_rng, rng_next(&sp->rng));
+    // spawn più rado: tra 0.8s e 1.6s circa, salvo modalità stress (--spawn-ms)
+    long long extra = (long long)(rng_next(&sp->rng) % 800) * 1000;
+    *wait_us = spawn_interval_ms > 0 ? spawn_interval_ms * 1000LL : 800000 + extra;
+    return flow;
+}
+
+// Seme del piano di spawn: --seed=N, altrimenti diverso a ogni avvio
+static uint64_t spawn_seed(void) {
+    return sim_seed ? sim_seed : ((uint64_t)time(NULL) << 20) ^ (uint64_t)getpid();
+}
+
+// Muove un singolo coccodrillo sul flusso indicato finché non esce dallo schermo
+// e invia posizioni assolute al padre (come in frogger_ultimate). Ritorna a fine corsa:
+// lo usano sia il figlio a fork singola sia i worker del pool.
+static void croc_run(int write_fd, int flow_index, long long t_assign, Rng rng) {
     int dir = (flussi[flow_index] == 0) ? +1 : -1;     // 0: sx→dx, 1: dx→sx (sceglie direzione)
     int y = flow_to_y(flow_index);                     // riga Y del flusso scelto
     // Non usare ncurses nel figlio. Usiamo la larghezza della finestra di gioco.
@@ -859,29 +2799,55 @@ static void croc_process(int write_fd, int flow_index) {
     int base = flow_speeds[flow_index] > 0 ? flow_speeds[flow_index] : 1; // garantisce >=1
     int speed = base;                                   // i passi per frame restano base
 
-    msg m; m.id = OBJ_CROC; m.pid = getpid(); m.x_speed = dir * speed; // prepara il messaggio da inviare
+    msg m; m.id = OBJ_CROC; m.pid = getpid(); m.x_speed = dir * speed; m.t_us = 0; // prepara il messaggio da inviare
     int shoot_cooldown = 0; // cooldown per evitare spari troppo frequenti
 
+    // Dead reckoning: un solo record di nascita, poi il padre calcola x da solo.
+    // Il figlio scandisce i passi su scadenze assolute per restare allineato al calcolo del padre.
+    long long t0 = now_us();
+    long long step = 0;
+    bool announced = false;                            // primo messaggio consegnato (latenza di spawn)
+    if (croc_protocol == CROC_PROTO_DR) {
+        m.id = OBJ_CROC_SPAWN; m.x = x; m.y = y; m.t_us = t0;
+        announced = producer_send(PRODUCER_CROC, write_fd, &m, true) == 0;
+        if (announced) record_spawn_latency(t_assign);
+    }
+
     while (1) {                                        // ciclo di vita del coccodrillo
-        m.x = x; m.y = y;                              // aggiorna coordinate da inviare al padre
-        write(write_fd, &m, sizeof(m));                // invia messaggio sulla pipe
+        if (croc_protocol == CROC_PROTO_POS) {
+            m.x = x; m.y = y;                          // aggiorna coordinate da inviare al padre
+            if (producer_send(PRODUCER_CROC, write_fd, &m, false) == 0 && !announced) { // a pipe piena salta il passo
+                announced = true;
+                record_spawn_latency(t_assign);
+            }
+        }
 
         // Logica di sparo casuale
         if (shoot_cooldown <= 0) {
-            int shoot_chance = rand() % 100; // probabilità 1 su 100 per frame
+            int shoot_chance = (int)(rng_next(&rng) % 100); // probabilità 1 su 100 per frame
             if (shoot_chance < 5) { // ~5% di probabilità di sparo (per testing)
+                // Il proiettile parte da una cella ESTERNA al corpo del coccodrillo
+                int projectile_x = (dir > 0) ? (x + CROC_W) : (x - 1);
+#if PROJECTILE_PROCESSES
                 pid_t projectile_pid = fork();
                 if (projectile_pid == 0) {
-                    // Processo proiettile: spara da una cella ESTERNA al corpo del coccodrillo
-                    int projectile_x = (dir > 0) ? (x + CROC_W) : (x - 1);
+                    // Processo proiettile
                     projectile_process(write_fd, projectile_x, y, dir, OBJ_PROJECTILE);
                 } else if (projectile_pid > 0) {
                     // Processo coccodrillo (padre) - continua normalmente
+                    count_fork();
                     shoot_cooldown = 30; // cooldown di 30 frame (~0.5 secondi)
                 } else {
                     // Errore nel fork
                     perror("fork projectile");
                 }
+#else
+                // Un solo evento di sparo: il padre fa avanzare il proiettile da sé
+                msg f = { .id = OBJ_FIRE, .x = projectile_x, .y = y, .pid = getpid(),
+                          .x_speed = dir, .t_us = now_us() };
+                producer_send(PRODUCER_CROC, write_fd, &f, true);
+                shoot_cooldown = 30; // cooldown di 30 frame (~0.5 secondi)
+#endif
             }
         } else {
             shoot_cooldown--;
@@ -892,35 +2858,239 @@ static void croc_process(int write_fd, int flow_index) {
             (dir < 0 && x + CROC_W < left_edge))       // o completamente a sinistra
             break;                                     // termina il loop
         // rallenta in base al fattore globale CROC_SPEED
-        usleep(CROC_SLEEP_US * CROC_SPEED);            // pausa tra un frame e l'altro
+        if (croc_protocol == CROC_PROTO_DR) {
+            step++;
+            long long deadline = t0 + step * CROC_TICK_US;
+            struct timespec ts = { .tv_sec = deadline / 1000000LL, .tv_nsec = (deadline % 1000000LL) * 1000L };
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+        } else {
+            usleep(CROC_TICK_US);                      // pausa tra un frame e l'altro
+        }
 
+#if PROJECTILE_PROCESSES
         // Reap non bloccante dei figli proiettile per evitare zombie
-        // (in modo che il processo padre possa rilevare correttamente la loro terminazione)
+        // (senza proiettili a processo il coccodrillo non ha figli: niente syscall a vuoto)
         pid_t zr;
         while ((zr = waitpid(-1, NULL, WNOHANG)) > 0) {
             // niente: solo raccolta
         }
+#endif
     }
+    // Avvisa sempre il padre che il coccodrillo è uscito: il padre non sonda più i processi
+    // con kill(pid, 0), e nel pool lo stesso pid guiderà il prossimo coccodrillo.
+    m.id = OBJ_CROC_DESPAWN;
+    producer_send(PRODUCER_CROC, write_fd, &m, true);
+}
+
+// Processo figlio a fork singola: un coccodrillo, poi termina (--croc-pool=off)
+static void croc_process(int write_fd, int flow_index, long long t_assign, Rng rng) {
+    // il figlio coccodrillo non usa il lato di lettura della pipe
+    close(pipe_fds[0]);                                // chiude la read-end (non serve qui)
+    croc_run(write_fd, flow_index, t_assign, rng);
     close(write_fd);                                   // chiude la write-end prima di uscire
     _exit(0);                                          // termina processo figlio
 }
 
+// Incarico per un worker del pool: il creatore lo scrive sulla pipe di controllo
+typedef struct {
+    int flow;                                          // flusso da percorrere
+    long long t_assign;                                // istante dell'assegnazione (latenza di spawn)
+    Rng rng;                                           // generatore degli spari, dal piano di spawn
+} CrocJob;
+
+// Worker del pool: attende un incarico, guida il coccodrillo, segnala la fine e torna in
+// attesa. Gli incarichi (< PIPE_BUF) sono letti interi anche con più lettori sulla pipe.
+static void croc_worker(int write_fd, int job_fd, int done_fd) {
+    prctl(PR_SET_PDEATHSIG, SIGKILL);                  // niente worker orfani se il creatore muore
+    CrocJob job;
+    while (read(job_fd, &job, sizeof(job)) == (ssize_t)sizeof(job)) {
+        croc_run(write_fd, job.flow, job.t_assign, job.rng);
+        char done = 1;
+        if (write(done_fd, &done, 1) != 1) break;      // creatore sparito
+    }
+    _exit(0);                                          // pipe di controllo chiusa: fine sessione
+}
+
+// Coccodrillo di un processo di flusso
+typedef struct {
+    int id;                                            // id sintetico (<= LANE_CROC_ID_FIRST)
+    int x;
+    int cooldown;                                      // passi prima del prossimo sparo possibile
+} LaneCroc;
+
+// Aggiornamento di corsia: tutte le posizioni del passo in una sola write() (<= PIPE_BUF,
+// quindi atomica: o passa intera o, a pipe piena, il passo viene saltato per intero)
+static void lane_send_batch(int write_fd, const msg *batch, int n) {
+    if (n == 0) return;
+    if (transport_mode == TRANSPORT_SHM && shm_ring) {
+        for (int k = 0; k < n; k++) producer_send(PRODUCER_CROC, write_fd, &batch[k], false);
+        return;
+    }
+    ProducerStats *ps = shared_stats ? &shared_stats->producers[PRODUCER_CROC] : NULL;
+    ssize_t wr = write(write_fd, batch, (size_t)n * sizeof(msg));
+    if (!ps) return;
+    if (wr == (ssize_t)((size_t)n * sizeof(msg))) {
+        atomic_fetch_add_explicit(&ps->sent, n, memory_order_relaxed);
+        atomic_fetch_add_explicit(&shared_stats->msgs_sent, n, memory_order_relaxed);
+    } else {
+        atomic_fetch_add_explicit(&ps->dropped, n, memory_order_relaxed);
+    }
+}
+
+// Processo di flusso: fa nascere, muove e fa sparare tutti i coccodrilli di una corsia.
+// Direzione e velocità del flusso valgono per tutti, quindi un solo orologio per corsia.
+// rng viene dal piano del creatore: a parità di --seed le corsie rifanno le stesse scelte.
+static void lane_process(int write_fd, int flow_index, Rng rng) {
+    int dir = (flussi[flow_index] == 0) ? +1 : -1;
+    int y = flow_to_y(flow_index);
+    int left_edge = 1;
+    int right_edge = GAME_WIDTH - 2;
+    int entry_x = (dir > 0) ? (left_edge - CROC_W) : right_edge;
+    int speed = flow_speeds[flow_index] > 0 ? flow_speeds[flow_index] : 1;
+    int cap = (max_active_crocs + N_FLUSSI - 1) / N_FLUSSI; // stesso totale della modalità a processi
+    if (cap > LANE_MAX_CROCS) cap = LANE_MAX_CROCS;
+    // Ritmo di nascita per corsia: quello globale del creatore moltiplicato per i flussi
+    long long spawn_every = (spawn_interval_ms > 0 ? spawn_interval_ms * 1000LL : 1200000LL) * N_FLUSSI;
+
+    LaneCroc crocs_here[LANE_MAX_CROCS];
+    msg batch[LANE_MAX_CROCS];
+    int n = 0;
+    int next_id = LANE_CROC_ID_FIRST - flow_index;     // id distinti tra le corsie: passo N_FLUSSI
+    long long t0 = now_us();
+    long long next_spawn = t0 + (long long)(rng_next(&rng) % spawn_every);  // corsie sfasate all'avvio
+
+    for (long long step = 0;; step++) {
+        long long t = t0 + step * CROC_TICK_US;
+        // Nascita: il nuovo coccodrillo entra solo se l'ultimo ha liberato l'ingresso
+        bool clear = n == 0 || (dir > 0 ? crocs_here[n - 1].x >= left_edge + 1 : crocs_here[n - 1].x + CROC_W <= right_edge - 1);
+        if (t >= next_spawn && n < cap && clear) {
+            crocs_here[n] = (LaneCroc){ .id = next_id, .x = entry_x, .cooldown = 0 };
+            next_id -= N_FLUSSI;
+            if (croc_protocol == CROC_PROTO_DR) {
+                msg s = { .id = OBJ_CROC_SPAWN, .x = entry_x, .y = y, .pid = crocs_here[n].id,
+                          .x_speed = dir * speed, .t_us = t };
+                if (producer_send(PRODUCER_CROC, write_fd, &s, true) == 0) record_spawn_latency(t);
+            } else {
+                record_spawn_latency(t);               // parte col batch di questo passo
+            }
+            n++;
+            next_spawn = t + spawn_every / 2 + (long long)(rng_next(&rng) % spawn_every);
+        }
+
+        if (croc_protocol == CROC_PROTO_POS) {
+            for (int k = 0; k < n; k++) {
+                batch[k] = (msg){ .id = OBJ_CROC, .x = crocs_here[k].x, .y = y, .pid = crocs_here[k].id,
+                                  .x_speed = dir * speed, .t_us = 0 };
+            }
+            lane_send_batch(write_fd, batch, n);
+        }
+
+        // Spari (gestiti dal padre anche nelle build con proiettili a processi: niente fork qui)
+        for (int k = 0; k < n; k++) {
+            LaneCroc *c = &crocs_here[k];
+            if (c->cooldown > 0) {
+                c->cooldown--;
+            } else if (rng_next(&rng) % 100 < 5) {
+                msg f = { .id = OBJ_FIRE, .x = (dir > 0) ? (c->x + CROC_W) : (c->x - 1), .y = y,
+                          .pid = c->id, .x_speed = dir, .t_us = now_us() };
+                producer_send(PRODUCER_CROC, write_fd, &f, true);
+                c->cooldown = 30;
+            }
+        }
+
+        // Avanzamento; chi esce viene annunciato sempre (anche con posizioni assolute),
+        // come i coccodrilli a processo
+        int kept = 0;
+        for (int k = 0; k < n; k++) {
+            LaneCroc c = crocs_here[k];
+            c.x += dir * speed;
+            if ((dir > 0 && c.x > right_edge) || (dir < 0 && c.x + CROC_W < left_edge)) {
+                msg d = { .id = OBJ_CROC_DESPAWN, .x = c.x, .y = y, .pid = c.id, .x_speed = dir * speed, .t_us = 0 };
+                producer_send(PRODUCER_CROC, write_fd, &d, true);
+                continue;
+            }
+            crocs_here[kept++] = c;
+        }
+        n = kept;
+
+        long long deadline = t + CROC_TICK_US;
+        struct timespec ts = { .tv_sec = deadline / 1000000LL, .tv_nsec = (deadline % 1000000LL) * 1000L };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+    }
+}
+
 // Processo creatore di coccodrilli (come in frogger_ultimate)
 // Processo figlio creatore: spawna periodicamente nuovi coccodrilli
 static void croc_creator(int write_fd) {
-    srand((unsigned)time(NULL) ^ (unsigned)getpid());       // inizializza RNG per il creatore
-    init_flussi();                                           // imposta direzioni dei flussi
-    init_flow_speeds_random();                               // imposta velocità iniziali dei flussi
+    SpawnPlan plan;                                          // flussi, velocità e sequenza di spawn
+    spawn_plan_init(&plan, spawn_seed());
     // chiude il lato di lettura: il creatore non legge dalla pipe
     close(pipe_fds[0]);                                      // chiude read-end non usata
-    int last_flow = -1;                                      // ricorda l'ultimo flusso usato
-    int last_last_flow = -1;                                 // penultimo flusso usato
-    int last_last_last_flow = -1;                            // terzultimo flusso usato
+    close(input_fds[0]);                                     // il canale input è solo della rana
+    close(input_fds[1]);
+    // write-end non bloccante per tutti i produttori (ereditata da coccodrilli e proiettili):
+    // un padre lento fa saltare posizioni invece di fermare i coccodrilli
+    if (flow_control) fcntl(write_fd, F_SETFL, fcntl(write_fd, F_GETFL, 0) | O_NONBLOCK);
+
+    // Modalità a corsie: il creatore guida il flusso 0 e forka gli altri N_FLUSSI-1,
+    // così i processi restano N_FLUSSI qualunque sia la densità del fiume
+    if (croc_lane_mode) {
+        Rng lane_rng[N_FLUSSI];                              // un Rng per corsia, estratto dal piano
+        for (int f = 0; f < N_FLUSSI; f++) rng_seed(&lane_rng[f], rng_next(&plan.rng));
+        for (int f = 1; f < N_FLUSSI; f++) {
+            pid_t lpid = fork();
+            if (lpid == 0) {
+                prctl(PR_SET_PDEATHSIG, SIGKILL);
+                lane_process(write_fd, f, lane_rng[f]);
+            } else if (lpid > 0) {
+                count_fork();
+            } else {
+                perror("fork lane");
+            }
+        }
+        lane_process(write_fd, 0, lane_rng[0]);
+    }
     int active_crocs = 0;                                    // numero di coccodrilli attivi
-    const int MAX_ACTIVE_CROCS = 16;                         // limite massimo per non saturare
+    const int MAX_ACTIVE_CROCS = max_active_crocs;           // limite massimo per non saturare
+
+    // Pool: MAX_ACTIVE_CROCS worker forkati una volta sola, finché il creatore è piccolo.
+    // Incarichi su job_fds, segnali di fine corsa su done_fds (non bloccante lato creatore).
+    int job_fds[2] = { -1, -1 }, done_fds[2] = { -1, -1 };
+    if (croc_pool_enabled && (pipe(job_fds) == -1 || pipe(done_fds) == -1)) croc_pool_enabled = 0;
+    if (croc_pool_enabled) {
+        fcntl(done_fds[0], F_SETFL, fcntl(done_fds[0], F_GETFL, 0) | O_NONBLOCK);
+        for (int w = 0; w < MAX_ACTIVE_CROCS; w++) {
+            pid_t wpid = fork();
+            if (wpid == 0) {
+                close(job_fds[1]);
+                close(done_fds[0]);
+                croc_worker(write_fd, job_fds[0], done_fds[1]);
+            } else if (wpid > 0) {
+                count_fork();
+            } else {
+                perror("fork croc worker");
+            }
+        }
+        close(job_fds[0]);
+        close(done_fds[1]);
+    }
+
     while (1) {                                              // ciclo infinito di spawn
+        if (croc_pool_enabled) {
+            char done[64];                                   // worker tornati nel pool
+            ssize_t rd;
+            while ((rd = read(done_fds[0], done, sizeof(done))) > 0) {
+                active_crocs -= (int)rd;
+                if (active_crocs < 0) active_crocs = 0;
+            }
+        }
         // se troppi coccodrilli sono attivi, aspetta e riprova
         if (active_crocs >= MAX_ACTIVE_CROCS) {              // controllo limite
+            if (croc_pool_enabled) {
+                struct pollfd p = { .fd = done_fds[0], .events = POLLIN, .revents = 0 };
+                poll(&p, 1, 250);                            // fino al primo worker libero
+                continue;
+            }
             pid_t rpid;                                      // variabile per waitpid non bloccante
             while ((rpid = waitpid(-1, NULL, WNOHANG)) > 0) { // raccogli figli terminati
                 if (active_crocs > 0) active_crocs--;         // decrementa numero attivi
@@ -928,43 +3098,203 @@ static void croc_creator(int write_fd) {
             usleep(250000); // 250 ms                         // attesa prima di riprovare
             continue;                                         // ricomincia ciclo
         }
-        // Scegli un flusso casuale tra 0 e N_FLUSSI-1
-        int flow = rand() % N_FLUSSI; // 0..7
-    
-        // Controlla anche il terzultimo flusso usato per evitare ripetizioni
-        // Dobbiamo tenere traccia di last_last_last_flow, last_last_flow, last_flow
-        // Se il flusso scelto è uguale a uno degli ultimi tre, aspetta e riprova
-
-        if (flow == last_flow || flow == last_last_flow || flow == last_last_last_flow) {
-            usleep(CREATOR_SLEEP_US); // attende un po' prima di riprovare
-            continue;                 // salta questo ciclo e riprova
-        }
-
-        // Aggiorna la memoria dei flussi usati: sposta indietro la storia
-        last_last_last_flow = last_last_flow; // il terzultimo diventa il quartultimo
-        last_last_flow = last_flow;           // il penultimo diventa il terzultimo
-        last_flow = flow;                     // aggiorna l'ultimo flusso usato
-        // memorizza scelta
-
-        pid_t pid = fork();                                   // crea un figlio coccodrillo
-        if (pid == 0) {
-            // Figlio coccodrillo: invia posizioni e termina a fine corsa
-            croc_process(write_fd, flow);                     // esegue logica coccodrillo
-        } else if (pid > 0) {
-            active_crocs++;                                   // incrementa contatore attivi
+        // Flusso casuale tra 0 e N_FLUSSI-1, mai uno degli ultimi tre (altrimenti aspetta e riprova)
+        long long wait_us;
+        Rng croc_rng;
+        int flow = spawn_plan_next(&plan, &wait_us, &croc_rng);
+        if (flow < 0) {
+            usleep((useconds_t)wait_us);                     // attende un po' prima di riprovare
+            continue;                                        // salta questo ciclo e riprova
+        }
+
+        if (croc_pool_enabled) {
+            // Un worker libero prende l'incarico: nessuna fork per coccodrillo
+            CrocJob job = { .flow = flow, .t_assign = now_us(), .rng = croc_rng };
+            if (write(job_fds[1], &job, sizeof(job)) == (ssize_t)sizeof(job)) active_crocs++;
         } else {
-            // Errore nel fork
-            perror("fork croc");
+            long long t_assign = now_us();
+            pid_t pid = fork();                               // crea un figlio coccodrillo
+            if (pid == 0) {
+                // Figlio coccodrillo: invia posizioni e termina a fine corsa
+                croc_process(write_fd, flow, t_assign, croc_rng); // esegue logica coccodrillo
+            } else if (pid > 0) {
+                count_fork();
+                active_crocs++;                               // incrementa contatore attivi
+            } else {
+                // Errore nel fork
+                perror("fork croc");
+            }
+            // reap non bloccante dei figli terminati per evitare zombie e aggiornare conteggio
+            pid_t rpid;                                      // variabile per waitpid non bloccante
+            while ((rpid = waitpid(-1, NULL, WNOHANG)) > 0) { // raccogli eventuali terminati
+                if (active_crocs > 0) active_crocs--;        // aggiorna contatore
+            }
         }
-        // reap non bloccante dei figli terminati per evitare zombie e aggiornare conteggio
-        pid_t rpid;                                          // variabile per waitpid non bloccante
-        while ((rpid = waitpid(-1, NULL, WNOHANG)) > 0) {    // raccogli eventuali terminati
-            if (active_crocs > 0) active_crocs--;            // aggiorna contatore
+        usleep((useconds_t)wait_us);                         // attesa prima di un nuovo spawn
+    }
+}
+
+// --- Simulazione locale (--sim=local) ---
+// Il padre esegue da sé la logica di croc_creator e croc_run a passo fisso: niente processi
+// né canale, gli stessi record (nascita, posizione, sparo, uscita) finiscono negli stessi
+// gestori del ciclo principale. Lo stato dopo il passo k dipende solo dal seme, non dai frame.
+#define SIM_STEP_US 10000                              // passo fisso: il mondo avanza di 10 ms alla volta
+
+// Coccodrillo simulato: lo stato che croc_run tiene in variabili locali
+typedef struct {
+    int id;                                            // id sintetico (<= LANE_CROC_ID_FIRST)
+    int flow;
+    int x;
+    int cooldown;                                      // passi prima del prossimo sparo possibile
+    long long next_us;                                 // istante del prossimo passo
+    Rng rng;                                           // spari: stesso generatore del processo
+} SimCroc;
+
+typedef struct {
+    SpawnPlan plan;
+    long long t_us;                                    // tempo simulato: inizio del prossimo passo
+    long long next_spawn_us;                           // prossima decisione del creatore
+    bool waiting_slot;                                 // al limite di coccodrilli: attende un'uscita
+    SimCroc *crocs;
+    int n, cap;
+    int next_id;
+    long long spawned, fired, steps;
+    uint64_t digest;                                   // FNV-1a dei record prodotti (determinismo)
+    int *trace;                                        // se non NULL: flussi dei coccodrilli partiti
+    int trace_n, trace_cap;
+} SimWorld;
+
+static SimWorld sim;
+
+// Record prodotto dalla simulazione: entra nell'impronta e va subito ai gestori del padre
+static void sim_emit(const msg *m) {
+    const long long fields[6] = { m->id, m->x, m->y, m->pid, m->x_speed, m->t_us };
+    const unsigned char *b = (const unsigned char *)fields;
+    for (size_t k = 0; k < sizeof(fields); k++) {
+        sim.digest ^= b[k];
+        sim.digest *= 0x100000001B3ULL;
+    }
+    if (m->id == OBJ_CROC) apply_croc_position(m);
+    else if (m->id == OBJ_CROC_SPAWN) apply_croc_spawn(m, m->t_us);
+    else if (m->id == OBJ_FIRE) spawn_analytic_projectile(m->x, m->y, m->x_speed, OBJ_PROJECTILE, m->t_us);
+    else if (m->id == OBJ_CROC_DESPAWN) apply_croc_despawn(m);
+}
+
+// Riparte da zero all'istante t0_us con il piano di spawn seminato come il creatore
+static void sim_start(long long t0_us) {
+    spawn_plan_init(&sim.plan, spawn_seed());
+    sim.t_us = t0_us;
+    sim.next_spawn_us = t0_us;
+    sim.waiting_slot = false;
+    sim.n = 0;
+    sim.next_id = LANE_CROC_ID_FIRST;
+    sim.spawned = sim.fired = sim.steps = 0;
+    sim.digest = 0xCBF29CE484222325ULL;
+    sim.trace_n = 0;
+}
+
+static void sim_spawn(int flow, long long t, Rng rng) {
+    if (sim.n == sim.cap) {
+        int cap = sim.cap ? sim.cap * 2 : 64;
+        SimCroc *grown = realloc(sim.crocs, (size_t)cap * sizeof(SimCroc));
+        if (!grown) return;                            // come una fork fallita: niente coccodrillo
+        sim.crocs = grown;
+        sim.cap = cap;
+    }
+    int dir = (flussi[flow] == 0) ? +1 : -1;
+    int speed = flow_speeds[flow] > 0 ? flow_speeds[flow] : 1;
+    int x = (dir > 0) ? (1 - CROC_W) : GAME_WIDTH - 2; // appena fuori dallo schermo
+    SimCroc *c = &sim.crocs[sim.n++];
+    *c = (SimCroc){ .id = sim.next_id--, .flow = flow, .x = x, .cooldown = 0, .next_us = t, .rng = rng };
+    sim.spawned++;
+    if (sim.trace && sim.trace_n < sim.trace_cap) sim.trace[sim.trace_n++] = flow;
+    if (croc_protocol == CROC_PROTO_DR) {
+        msg s = { .id = OBJ_CROC_SPAWN, .x = x, .y = flow_to_y(flow), .pid = c->id, .x_speed = dir * speed, .t_us = t };
+        sim_emit(&s);
+    }
+}
+
+// Un passo di croc_run; false quando il coccodrillo esce (next_us resta l'istante dell'uscita)
+static bool sim_croc_step(SimCroc *c) {
+    int dir = (flussi[c->flow] == 0) ? +1 : -1;
+    int speed = flow_speeds[c->flow] > 0 ? flow_speeds[c->flow] : 1;
+    int y = flow_to_y(c->flow);
+    if (croc_protocol == CROC_PROTO_POS) {
+        msg m = { .id = OBJ_CROC, .x = c->x, .y = y, .pid = c->id, .x_speed = dir * speed, .t_us = 0 };
+        sim_emit(&m);
+    }
+    if (c->cooldown <= 0) {
+        if (rng_next(&c->rng) % 100 < 5) {
+            msg f = { .id = OBJ_FIRE, .x = (dir > 0) ? (c->x + CROC_W) : (c->x - 1), .y = y,
+                      .pid = c->id, .x_speed = dir, .t_us = c->next_us };
+            sim_emit(&f);
+            sim.fired++;
+            c->cooldown = 30;
+        }
+    } else {
+        c->cooldown--;
+    }
+    c->x += dir * speed;
+    if ((dir > 0 && c->x > GAME_WIDTH - 2) || (dir < 0 && c->x + CROC_W < 1)) {
+        msg d = { .id = OBJ_CROC_DESPAWN, .x = c->x, .y = y, .pid = c->id, .x_speed = dir * speed, .t_us = 0 };
+        sim_emit(&d);
+        return false;
+    }
+    c->next_us += CROC_TICK_US;
+    return true;
+}
+
+// Avanza a passi fissi fino a until_us; il passo non ancora concluso resta per il frame dopo
+static void sim_advance(long long until_us) {
+    while (sim.t_us + SIM_STEP_US <= until_us) {
+        long long end = sim.t_us + SIM_STEP_US;
+        // Creatore: le decisioni scadute nel passo, come farebbe croc_creator col pool
+        while (!sim.waiting_slot && sim.next_spawn_us < end) {
+            long long t = sim.next_spawn_us;
+            if (sim.n >= max_active_crocs) {
+                sim.waiting_slot = true;               // riprova alla prima uscita
+                break;
+            }
+            long long wait_us;
+            Rng croc_rng;
+            int flow = spawn_plan_next(&sim.plan, &wait_us, &croc_rng);
+            if (flow >= 0) sim_spawn(flow, t, croc_rng);
+            sim.next_spawn_us = t + wait_us;
         }
-        // spawn più rado: tra 0.8s e 1.6s circa
-        int extra = (rand() % 800) * 1000; // 0..800ms        // jitter casuale
-        usleep(800000 + extra);                               // attesa prima di un nuovo spawn
+        // Coccodrilli: tutti i passi scaduti, in ordine di nascita; chi esce viene compattato
+        int kept = 0;
+        for (int k = 0; k < sim.n; k++) {
+            SimCroc c = sim.crocs[k];
+            bool alive = true;
+            while (alive && c.next_us < end) alive = sim_croc_step(&c);
+            if (alive) {
+                sim.crocs[kept++] = c;
+            } else if (sim.waiting_slot) {
+                sim.waiting_slot = false;
+                if (sim.next_spawn_us < c.next_us) sim.next_spawn_us = c.next_us;
+            }
+        }
+        sim.n = kept;
+        sim.t_us = end;
+        sim.steps++;
+    }
+}
+
+// Avvia la sorgente dei coccodrilli: il processo creatore oppure, con --sim=local, la
+// simulazione nel padre (0: nessun processo). -1 se la fork fallisce.
+static pid_t start_croc_source(void) {
+    if (sim_local) {
+        sim_start(now_us());
+        return 0;
     }
+    pid_t cp = fork();
+    if (cp > 0) count_fork();
+    if (cp == 0) {
+        // processo creatore: non usare ncurses, invia solo su pipe
+        croc_creator(pipe_fds[1]);
+        _exit(0);
+    }
+    return cp;
 }
 // Processo figlio: legge l'input del giocatore e invia delta movimento al padre
 static void frog_process(int write_fd, int start_x, int start_y) {
@@ -977,6 +3307,7 @@ static void frog_process(int write_fd, int start_x, int start_y) {
     m.pid = getpid();                     // salva pid del processo figlio
     m.x   = 0;                            // delta x da inviare (inizialmente 0)
     m.y   = 0;                            // delta y da inviare (inizialmente 0)
+    m.t_us = 0;                           // istante d'invio (lo scrive input_send)
 
     // Latch: invia la richiesta di granate solo al fronte di pressione (key down)
     int space_latch = 0;                  // 0 = rilasciato, 1 = tenuto premuto
@@ -990,7 +3321,7 @@ static void frog_process(int write_fd, int start_x, int start_y) {
             // invia un messaggio di quit al padre prima di terminare
             m.id = OBJ_QUIT;                // cambia tipo messaggio in QUIT
             m.x = 0; m.y = 0; m.x_speed = 0; // azzera i campi di movimento
-            write(write_fd, &m, sizeof(m));  // invia la richiesta
+            input_send(write_fd, &m);        // invia la richiesta
             break;                           // esce dal ciclo (termina il figlio)
         }
         else if (input == KEY_UP)    dy = -FROG_H;   // salta di una altezza rana verso l'alto
@@ -1003,7 +3334,7 @@ static void frog_process(int write_fd, int start_x, int start_y) {
             m.x = frog_x;       // passa la posizione corrente della rana al padre
             m.y = frog_y;
             m.x_speed = 0;
-            write(write_fd, &m, sizeof(m));
+            input_send(write_fd, &m);
             space_latch = 1;              // evita richieste ripetute finché resta premuto
             dx = 0; dy = 0;
         }
@@ -1011,7 +3342,7 @@ static void frog_process(int write_fd, int start_x, int start_y) {
             // Richiesta di teletrasporto alla riva superiore
             m.id = OBJ_TELEPORT;
             m.x = 0; m.y = 0; m.x_speed = 0;
-            write(write_fd, &m, sizeof(m));
+            input_send(write_fd, &m);
             i_latch = 1;
             dx = 0; dy = 0;
         }
@@ -1021,7 +3352,7 @@ static void frog_process(int write_fd, int start_x, int start_y) {
             m.x = dx;                     // imposta delta x
             m.y = dy;                     // imposta delta y
             m.x_speed = 0;                // velocità non usata per la rana
-            write(write_fd, &m, sizeof(m)); // invia messaggio di movimento
+            input_send(write_fd, &m);       // invia messaggio di movimento
         }
 
         // Se la barra spaziatrice non è attualmente premuta, sblocca il latch
@@ -1044,6 +3375,7 @@ static void start_new_manche(void) {
     frog_y = Y_MARCIAPIEDE;              // piazza la rana sul marciapiede
     frog_x = (max_x - FROG_W) / 2;       // centra la rana orizzontalmente
     if (frog_x < 1) frog_x = 1;          // evita che tocchi il bordo sinistro
+    frog_prev_x = frog_x;                // nessun tratto percorso verso la nuova posizione
 
     // Le granate sono processi separati, non oggetti da resettare
 }
@@ -1096,7 +3428,8 @@ static void init_game_data(void) {
     // Stato iniziale della rana
     init_frog_state();
 
-    // Le granate ora sono processi, non oggetti da inizializzare
+    // Tabelle coccodrilli/proiettili vuote, con free list e indici pid
+    reset_entity_tables();
 }
 
 // Inizializza tutto il sistema di gioco
@@ -1107,47 +3440,53 @@ static void init_game_system(void) {
 }
 
 // Processo padre: setup, fork dei figli, ciclo di gioco e pulizia finale
-int main(void) {                                // entry point del processo padre (gioco)
+int main(int argc, char **argv) {               // entry point del processo padre (gioco)
+    parse_args(argc, argv);                     // opzioni da riga di comando (trasporto, benchmark)
+    if (bench_name) return run_bench(bench_name); // benchmark senza ncurses
+
     init_game_system();                         // inizializza tutto il sistema
 
 // Dimensioni interne finestra (servono per clamp)
 int max_y, max_x;                               // dimensioni finestra
 getmaxyx(game_win, max_y, max_x);               // ottiene righe/colonne
 
+// Contatori condivisi (fork, messaggi): prima di qualsiasi fork
+stats_init();
+
 // Crea pipe per comunicazione padre<-figli (non bloccante lato lettura)
-if (pipe(pipe_fds) == -1) {                     // crea pipe (padre legge, figli scrivono)
-    endwin(); perror("pipe"); return 1;        // errore: chiudi ncurses ed esci
+if (transport_open() == -1) {                   // crea pipe (+ ring shm se richiesto) prima dei fork
+    endwin(); perror("transport"); return 1;   // errore: chiudi ncurses ed esci
 }
 
 // Calcola posizione iniziale (passala pure anche se il figlio non la usa ora)
 int start_rx = (max_x - FROG_W) / 2;            // x iniziale rana (centrata)
 int start_ry = Y_MARCIAPIEDE;                   // y iniziale rana (marciapiede)
 
+// SIGCHLD su signalfd prima delle fork (i figli ereditano la maschera)
+child_events_open();
+
 // Fork
 pid_t frog_pid = fork();
 if (frog_pid < 0) { endwin(); perror("fork"); return 1; }
+if (frog_pid > 0) count_fork();
 
 if (frog_pid == 0) {
     // FIGLIO (produttore)
     close(pipe_fds[0]); // chiude read end
+    close(input_fds[0]);
     // Evita side-effect ncurses dal figlio come in frogger_ultimate
     int devnull = open("/dev/null", O_WRONLY);
     if (devnull >= 0) {
         dup2(devnull, STDOUT_FILENO);
         dup2(devnull, STDERR_FILENO);
     }
-    frog_process(pipe_fds[1], start_rx, start_ry);
+    frog_process(input_fds[1], start_rx, start_ry); // i tasti viaggiano sul canale input
     _exit(0);
 }
 
 // Fork del creatore (come in frogger_ultimate): usa la stessa write-end
-pid_t creator_pid = fork();
+pid_t creator_pid = start_croc_source();
 if (creator_pid < 0) { endwin(); perror("fork"); return 1; }
-if (creator_pid == 0) {
-    // processo creatore: non usare ncurses, invia solo su pipe
-    croc_creator(pipe_fds[1]);
-    _exit(0);
-}
 
 // PADRE (consumatore): manteniamo aperto il lato di scrittura, così i figli
 // granata creati dal padre potranno scrivere sulla pipe.
@@ -1179,8 +3518,15 @@ wrefresh(game_win);                              // mostra
 napms(800);                                      // piccola pausa
 
 int running = 1;
+loop_open();                                     // ciclo a eventi (epoll + timerfd) se disponibile
+session_start_us = now_us();
+session_ctxt0 = system_ctxt_switches();
 
 while (running) {
+    long long frame_t0 = now_us();              // inizio del lavoro del frame (statistiche)
+    if (session_secs > 0 && frame_t0 - session_start_us >= session_secs * 1000000LL) {
+        break;                                  // --session-secs: sessione di misura conclusa
+    }
 
     int elapsed = (int)(time(NULL) - manche_start);
 if (elapsed >= MANCHE_TIME) {
@@ -1202,131 +3548,149 @@ if (elapsed >= MANCHE_TIME) {
     int acc_dx = 0;
     int acc_dy = 0;
 
-    // Azzera i delta di movimento per frame dei coccodrilli
-    for (int i = 0; i < MAX_CROCS; i++) {
-        if (crocs[i].in_use) crocs[i].dx_frame = 0;
-    }
-
-    // Dreniamo i messaggi dalla pipe con un limite per frame per evitare starvation
-    for (int drained = 0; drained < MAX_MSGS_PER_FRAME; drained++) {
-        msg m; // Alloco una variabile di tipo msg per ricevere il messaggio dalla pipe.
-        ssize_t n = read(pipe_fds[0], &m, sizeof(m)); // Leggo dalla pipe (lato lettura) un messaggio di dimensione msg.
-        if (n > 0) { // Se ho letto effettivamente dei dati (n > 0)...
-            if (m.id == OBJ_RANA) { // Se il messaggio riguarda la rana...
-                // Accumula il movimento (applicheremo dopo il riding)
-                acc_dx += m.x;
-                acc_dy += m.y;
-            } else if (m.id == OBJ_TELEPORT && m.pid == frog_pid) {
-                // Teletrasporto: porta la rana sulla riva superiore (erba, sotto le tane)
-                frog_y = Y_RIVA; // riga della riva superiore
-                // Mantieni la x corrente e applica i bounds
-                if (frog_x < 1) frog_x = 1;
-                if (frog_x + FROG_W > max_x - 1) frog_x = (max_x - 1) - FROG_W;
-            } else if (m.id == OBJ_GRENADE && m.pid == frog_pid) {
-                // Consenti il fuoco solo se la rana è nella fascia fiume
-                if (frog_y >= Y_FIUME && frog_y < Y_MARCIAPIEDE) {
-                    // Il padre crea due processi proiettile: a sinistra e a destra
-                    // Usa la posizione corrente della rana mantenuta dal padre
-                    long long t = now_ms();
-                    if (t - last_grenade_ms < GRENADE_COOLDOWN_MS) {
-                        // cooldown non ancora passato: ignora richiesta
-                    } else {
-                        last_grenade_ms = t;
-                        int gx = frog_x;
-                        int gy = frog_y;
-                        pid_t lg = fork();
-                        if (lg == 0) {
-                            // Spawn a sinistra: inizia subito fuori dalla rana
-                            projectile_process(pipe_fds[1], gx - 1, gy, -1, OBJ_GRENADE);
-                            _exit(0);
-                        }
-                        pid_t rg = fork();
-                        if (rg == 0) {
-                            // Spawn a destra: inizia subito fuori dalla rana
-                            projectile_process(pipe_fds[1], gx + FROG_W, gy, +1, OBJ_GRENADE);
-                            _exit(0);
-                        }
-                    }
+    // Azzera i delta di movimento per frame dei coccodrilli e fissa l'inizio dei tratti percorsi
+    begin_frame_lanes();
+
+    // Dreniamo i messaggi disponibili in un solo batch (limite per frame per evitare starvation)
+    // Prima il canale input della rana, poi quelli già drenati durante l'attesa del ciclo
+    // a eventi, poi il resto: un tasto non resta mai dietro al limite MAX_MSGS_PER_FRAME
+    msg batch[INPUT_MAX_PER_FRAME + MAX_MSGS_PER_FRAME];
+    pipe_sample_occupancy();                    // arretrato nella pipe prima di drenare
+    int ninput = input_recv_batch(batch, INPUT_MAX_PER_FRAME);
+    stat_msgs_recv += ninput;
+    int npend = pending_n;
+    memcpy(batch + ninput, pending_msgs, (size_t)npend * sizeof(msg));
+    pending_n = 0;
+    npend += ninput;
+    int nbatch = (npend < INPUT_MAX_PER_FRAME + MAX_MSGS_PER_FRAME)
+               ? transport_recv_batch(batch + npend, INPUT_MAX_PER_FRAME + MAX_MSGS_PER_FRAME - npend) : 0;
+    if (nbatch > 0) stat_msgs_recv += nbatch;
+    if (nbatch < 0) {
+        // pipe chiusa dall'altra estremità (errno == 0) oppure errore vero
+        if (errno != 0) perror("read");
+        running = 0;
+        nbatch = 0;
+    }
+    nbatch += npend;
+    frame_inputs = 0;
+    frame_input_t_sum = 0;
+    for (int k = 0; k < nbatch; k++) {
+        if (!is_frog_input(&batch[k])) continue;
+        if (frame_inputs == 0 || batch[k].t_us < frame_input_t_min) frame_input_t_min = batch[k].t_us;
+        frame_inputs++;
+        frame_input_t_sum += batch[k].t_us;
+    }
+    // Aggiornamenti di posizione superati nello stesso batch: si applica solo l'ultimo per pid
+    bool superseded[INPUT_MAX_PER_FRAME + MAX_MSGS_PER_FRAME];
+    frame_pos_msgs = 0;
+    for (int k = 0; k < nbatch; k++) frame_pos_msgs += is_position_msg(&batch[k]);
+    if (coalesce_enabled) {
+        frame_pos_skipped = coalesce_positions(batch, nbatch, superseded);
+    } else {
+        frame_pos_skipped = 0;
+        memset(superseded, 0, sizeof(superseded));
+    }
+    stat_pos_msgs += frame_pos_msgs;
+    stat_pos_skipped += frame_pos_skipped;
+
+    for (int k = 0; k < nbatch; k++) {
+        if (superseded[k]) continue;
+        msg m = batch[k]; // messaggio corrente del batch
+        if (m.id == OBJ_RANA) { // Se il messaggio riguarda la rana...
+            // Accumula il movimento (applicheremo dopo il riding)
+            acc_dx += m.x;
+            acc_dy += m.y;
+        } else if (m.id == OBJ_TELEPORT && m.pid == frog_pid) {
+            // Teletrasporto: porta la rana sulla riva superiore (erba, sotto le tane)
+            frog_y = Y_RIVA; // riga della riva superiore
+            // Mantieni la x corrente e applica i bounds
+            if (frog_x < 1) frog_x = 1;
+            if (frog_x + FROG_W > max_x - 1) frog_x = (max_x - 1) - FROG_W;
+        } else if (m.id == OBJ_GRENADE && m.pid == frog_pid) {
+            // Consenti il fuoco solo se la rana è nella fascia fiume
+            if (frog_y >= Y_FIUME && frog_y < Y_MARCIAPIEDE) {
+                // Il padre crea due processi proiettile: a sinistra e a destra
+                // Usa la posizione corrente della rana mantenuta dal padre
+                long long t = now_ms();
+                if (t - last_grenade_ms < GRENADE_COOLDOWN_MS) {
+                    // cooldown non ancora passato: ignora richiesta
                 } else {
-                    // Fuori dal fiume: ignora la richiesta di granata
-                }
-            } else if (m.id == OBJ_CROC) { // Se il messaggio riguarda un coccodrillo...
-                CrocState* cs = get_croc_slot(m.pid); // Cerco (o alloco) lo slot del coccodrillo corrispondente al pid ricevuto.
-                if (cs) {
-                    int prev_x = cs->x;
-                    if (cs->has_pos) {
-                        cs->dx_frame += (m.x - prev_x); // accumula il delta mosso in questo frame
-                    } else {
-                        cs->has_pos = 1; // prima posizione valida
-                        // niente delta al primo update per evitare salti
+                    last_grenade_ms = t;
+                    int gx = frog_x;
+                    int gy = frog_y;
+#if PROJECTILE_PROCESSES
+                    pid_t lg = fork();
+                    if (lg == 0) {
+                        // Spawn a sinistra: inizia subito fuori dalla rana
+                        projectile_process(pipe_fds[1], gx - 1, gy, -1, OBJ_GRENADE);
+                        _exit(0);
                     }
-                    cs->x = m.x; // Aggiorna la posizione x del coccodrillo.
-                    cs->y = m.y; // Aggiorna la posizione y del coccodrillo.
-                    cs->x_speed = m.x_speed; // Aggiorna la velocità orizzontale del coccodrillo.
-                }
-            } else if (m.id == OBJ_PROJECTILE) { // Se il messaggio riguarda un proiettile coccodrillo...
-                ProjectileState* ps = get_projectile_slot(m.pid);
-                if (ps) {
-                    ps->id = OBJ_PROJECTILE;
-                    // Se è la prima volta che riceviamo un messaggio da questo proiettile,
-                    // determina la direzione dal coccodrillo che lo ha sparato
-                    if (ps->direction == 0) {
-                        // Cerca il coccodrillo alla stessa altezza del proiettile
-                        for (int i = 0; i < MAX_CROCS; i++) {
-                            if (crocs[i].in_use && crocs[i].y == m.y) {
-                                // Determina direzione dal movimento del coccodrillo
-                                ps->direction = (crocs[i].x_speed > 0) ? 1 : -1;
-                                break;
-                            }
-                        }
-                        if (ps->direction == 0) ps->direction = 1; // fallback
+                    if (lg > 0) count_fork();
+                    pid_t rg = fork();
+                    if (rg == 0) {
+                        // Spawn a destra: inizia subito fuori dalla rana
+                        projectile_process(pipe_fds[1], gx + FROG_W, gy, +1, OBJ_GRENADE);
+                        _exit(0);
                     }
-                    ps->x = m.x;
-                    ps->y = m.y;
+                    if (rg > 0) count_fork();
+#else
+                    // Granate come entità del padre: nessun processo
+                    long long t0 = now_us();
+                    spawn_analytic_projectile(gx - 1, gy, -1, OBJ_GRENADE, t0);
+                    spawn_analytic_projectile(gx + FROG_W, gy, +1, OBJ_GRENADE, t0);
+#endif
                 }
-            } else if (m.id == OBJ_GRENADE) { // Se il messaggio riguarda una granata (proiettile rana)
-                ProjectileState* ps = get_projectile_slot(m.pid);
-                if (ps) {
-                    ps->id = OBJ_GRENADE;
-                    if (ps->direction == 0) {
-                        ps->direction = (m.x_speed >= 0) ? 1 : -1;
-                    }
-                    ps->x = m.x;
-                    ps->y = m.y;
+            } else {
+                // Fuori dal fiume: ignora la richiesta di granata
+            }
+        } else if (m.id == OBJ_CROC) { // Se il messaggio riguarda un coccodrillo...
+            apply_croc_position(&m);
+        } else if (m.id == OBJ_CROC_SPAWN) { // Nascita di un coccodrillo a dead reckoning
+            apply_croc_spawn(&m, now_us()); // posizione già maturata mentre il record era in coda
+        } else if (m.id == OBJ_FIRE) { // Sparo di un coccodrillo: proiettile gestito dal padre
+            spawn_analytic_projectile(m.x, m.y, m.x_speed, OBJ_PROJECTILE, m.t_us);
+        } else if (m.id == OBJ_CROC_DESPAWN) { // Il coccodrillo è uscito: libera lo slot
+            apply_croc_despawn(&m);
+        } else if (m.id == OBJ_PROJECTILE) { // Se il messaggio riguarda un proiettile coccodrillo...
+            apply_projectile_position(&m);
+        } else if (m.id == OBJ_PROJECTILE_GONE) { // Processo proiettile/granata terminato
+            release_exited_pid(m.pid);
+        } else if (m.id == OBJ_GRENADE) { // Se il messaggio riguarda una granata (proiettile rana)
+            ProjectileState* ps = get_projectile_slot(m.pid);
+            int p = ps ? projectile_place((int)(ps - projectiles), m.y) : -1;
+            if (p >= 0) {
+                ProjectileLane *L = &projectile_lanes[ps->lane];
+                L->id[p] = OBJ_GRENADE;
+                if (L->direction[p] == 0) {
+                    L->direction[p] = (m.x_speed >= 0) ? 1 : -1;
                 }
-            } else if (m.id == OBJ_QUIT) {
-                // richiesta di uscita dal figlio rana
-                running = 0;
-                break;
+                projectile_lane_set_x(L, p, m.x);
             }
-            continue; // Dopo aver gestito il messaggio, torno all'inizio del ciclo per leggere altri messaggi (entro il limite).
-        }
-        if (n == 0) { // Se read restituisce 0, la pipe è stata chiusa dall'altra estremità.
-            running = 0; // Imposto running a 0 per terminare il ciclo principale del gioco.
-            break; // Esco dal ciclo di lettura messaggi.
-        }
-        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-            // Se read restituisce -1 e errno è EAGAIN/EWOULDBLOCK, non ci sono più messaggi disponibili al momento (pipe non bloccante).
-            break; // Esco dal ciclo di lettura messaggi.
-        }
-        if (n < 0) { // Se read restituisce -1 per altri motivi (errore vero)...
-            perror("read"); // Stampo l'errore.
-            running = 0; // Imposto running a 0 per terminare il ciclo principale del gioco.
-            break; // Esco dal ciclo di lettura messaggi.
-        }
-    }
-
-    // Reap non bloccante dei figli proiettile/granata creati dal padre per evitare zombie
-    {
-        pid_t zr;
-        while ((zr = waitpid(-1, NULL, WNOHANG)) > 0) {
-            // solo raccolta
+        } else if (m.id == OBJ_QUIT) {
+            // richiesta di uscita dal figlio rana
+            running = 0;
+            break;
         }
     }
 
+    // Figli del padre terminati (granate a processo, rana, creatore): raccolti e slot liberati
+    reap_children();
+
+    // Simulazione locale a passo fisso fino all'istante del frame, poi coccodrilli a dead
+    // reckoning e proiettili del padre: posizione calcolata per questo frame
+    long long t_frame = now_us();
+    if (sim_local) sim_advance(t_frame);
+    advance_dead_reckoned_crocs(t_frame);
+    advance_analytic_projectiles(t_frame);
+    // Corsie di nuovo ordinate per x: le query di collisione fanno ricerca binaria
+    sort_entity_lanes();
+    rebuild_collision_bitboards();
+
+    // Inizio del tratto percorso dalla rana nel frame (riding, input e aggancio compresi)
+    frog_prev_x = frog_x;
     // Riding: se la rana è su un coccodrillo, prima si muove con lui
     int ride_dx = 0;
-    bool on_croc = is_frog_on_croc(&ride_dx);
+    bool on_croc = is_frog_riding_croc(&ride_dx);
     // Se il giocatore sta dando un input orizzontale in questo frame,
     // non applichiamo il riding per non contrastare il movimento volontario.
     if (on_croc) {
@@ -1408,13 +3772,41 @@ if (elapsed >= MANCHE_TIME) {
 
     // Disegna tutto il frame di gioco
     draw_game_frame();
+    frame_recv_syscalls = 0;                    // i contatori della riga di debug ripartono
+    frame_recv_msgs = 0;                        // (l'attesa seguente conta per il prossimo frame)
+
+    // Tempo di lavoro del frame (esclusa la pausa) e latenza degli input appena presentati
+    {
+        long long t_end = now_us();
+        long long dt = t_end - frame_t0;
+        stat_frames++;
+        stat_frame_us_sum += dt;
+        if (dt > stat_frame_us_max) stat_frame_us_max = dt;
+        if (frame_inputs > 0) {
+            stat_inputs += frame_inputs;
+            stat_input_lat_sum += frame_inputs * t_end - frame_input_t_sum;
+            if (t_end - frame_input_t_min > stat_input_lat_max) stat_input_lat_max = t_end - frame_input_t_min;
+        }
+    }
 
-    // Piccola pausa
-    napms(16);
+    // Attesa del prossimo frame (timerfd + epoll, oppure pausa fissa con --loop=sleep)
+    loop_wait_frame();
 }
 
 // Chiusura del main: cleanup finale e uscita
 full_cleanup(frog_pid, creator_pid);
+loop_close();
+child_events_close();
+if (show_stats) {
+    print_session_stats();
+} else {
+    if (croc_arena.dropped || projectile_arena.dropped) {
+        print_arena_stats();                      // aggiornamenti persi: segnalali sempre
+    }
+    if (producers_dropped()) {
+        print_producer_stats();                   // idem per i messaggi saltati a pipe piena
+    }
+}
 return 0;
 }
 
@@ -1428,22 +3820,20 @@ static void terminate_process(pid_t pid) {
 
 // Termina tutti i processi coccodrilli attivi
 static void cleanup_crocs(void) {
-    for (int i = 0; i < MAX_CROCS; i++) {
+    for (int i = 0; i < croc_arena.cap; i++) {
         if (crocs[i].in_use && crocs[i].pid > 0) {
             terminate_process(crocs[i].pid);
-            crocs[i].in_use = 0;
-            crocs[i].pid = -1;
+            release_croc_slot(i);
         }
     }
 }
 
 // Termina tutti i processi proiettili attivi
 static void cleanup_projectiles(void) {
-    for (int i = 0; i < MAX_PROJECTILES; i++) {
+    for (int i = 0; i < projectile_arena.cap; i++) {
         if (projectiles[i].in_use && projectiles[i].pid > 0) {
             terminate_process(projectiles[i].pid);
-            projectiles[i].in_use = 0;
-            projectiles[i].pid = -1;
+            release_projectile_slot(i);
         }
     }
 }
@@ -1461,13 +3851,17 @@ static void cleanup_pipes(void) {
         close(pipe_fds[1]);
         pipe_fds[1] = -1;
     }
+    transport_close();
 }
 
 // Gestisce le collisioni della rana e determina se deve morire
 static void handle_frog_collisions(int* running, pid_t* frog_pid, pid_t* creator_pid) {
-    // Ri-controlla se la rana è su un coccodrillo dopo tutto il movimento
-    int final_ride_dx = 0;
-    bool final_on_croc = is_frog_on_croc(&final_ride_dx);
+    // Ri-controlla se la rana è su un coccodrillo dopo tutto il movimento (bitboard di riga)
+    bool final_on_croc = bitboard_frog_on_croc();
+#if BITBOARD_CHECK
+    if (final_on_croc != is_frog_on_croc(NULL)) stat_bitboard_mismatch++;
+    if (!bitboard_projectile_hits_frog() && find_projectile_hitting_frog() >= 0) stat_bitboard_mismatch++;
+#endif
 
     // Controlla se la rana è in acqua e non su un coccodrillo (morte!)
     bool frog_in_water = (frog_y >= Y_FIUME && frog_y < Y_MARCIAPIEDE) && !final_on_croc;
@@ -1538,6 +3932,30 @@ static void draw_game_frame(void) {
 
     // Debug: mostra coordinate rana in alto
     mvwprintw(game_win, 0, 2, "frog x=%d y=%d   ", frog_x, frog_y);
+    // Debug: syscall di lettura e messaggi drenati in questo frame
+    if (frame_recv_syscalls > 0) {
+        mvwprintw(game_win, 0, 24, " rd/frame=%d msg/frame=%d msg/rd=%.1f ",
+                  frame_recv_syscalls, frame_recv_msgs, (double)frame_recv_msgs / frame_recv_syscalls);
+    } else {
+        mvwprintw(game_win, 0, 24, " rd/frame=0 msg/frame=%d ", frame_recv_msgs);
+    }
+    // Debug: coalescenza (posizioni applicate / ricevute nel frame)
+    if (frame_pos_msgs > 0) {
+        mvwprintw(game_win, 0, 68, " pos %d->%d (-%.0f%%) ", frame_pos_msgs, frame_pos_msgs - frame_pos_skipped,
+                  100.0 * frame_pos_skipped / frame_pos_msgs);
+    }
+    // Debug: occupazione della pipe (ora, massimo di sessione) e andamento degli ultimi secondi
+    if (pipe_capacity > 0 && transport_mode != TRANSPORT_SHM) {
+        static const char *levels[] = { " ", "▁", "▂", "▃", "▄", "▅", "▆", "▇", "█" };
+        mvwprintw(game_win, GAME_HEIGHT - 1, 2, " pipe %3d%% hwm %3d%% di %dK ",
+                  (int)(100LL * frame_pipe_bytes / pipe_capacity), (int)(100LL * stat_pipe_hwm / pipe_capacity),
+                  pipe_capacity / 1024);
+        int col = getcurx(game_win);
+        for (int c = 0; c < PIPE_SPARK_CELLS; c++) {
+            int lv = (int)(((long long)pipe_spark[c] * 8 + pipe_capacity - 1) / pipe_capacity);
+            mvwaddstr(game_win, GAME_HEIGHT - 1, col + c, levels[lv > 8 ? 8 : lv]);
+        }
+    }
 
     // Mostra il frame
     wrefresh(game_win);
@@ -1594,21 +4012,18 @@ static void restart_game(pid_t* frog_pid, pid_t* creator_pid) {
 
     // Svuota pipe e ri-creala per sicurezza
     cleanup_pipes();
-    if (pipe(pipe_fds) == -1) {
-        endwin(); perror("pipe"); exit(1);
+    if (transport_open() == -1) {
+        endwin(); perror("transport"); exit(1);
     }
     int fl = fcntl(pipe_fds[0], F_GETFL, 0);
     fcntl(pipe_fds[0], F_SETFL, fl | O_NONBLOCK);
+    loop_watch_transport();                 // il canale è nuovo: va ri-registrato in epoll
 
     // Reset totale stato logico
     lives = LIVES_START;
     score = 0;
     for (int i = 0; i < 5; ++i) tane_closed[i] = 0;
     last_grenade_ms = -1000000000LL;
-    // Pulisci slot locali
-    for (int i = 0; i < MAX_CROCS; ++i) { crocs[i].in_use = 0; crocs[i].pid = -1; }
-    for (int i = 0; i < MAX_PROJECTILES; ++i) { projectiles[i].in_use = 0; projectiles[i].pid = -1; projectiles[i].direction = 0; }
-
     // Recompute layout (se finestra cambiata)
     compute_tane_layout();
     if (bg_win) draw_background_into(bg_win); else draw_background();
@@ -1620,22 +4035,20 @@ static void restart_game(pid_t* frog_pid, pid_t* creator_pid) {
 
     pid_t fp = fork();
     if (fp < 0) { endwin(); perror("fork"); exit(1); }
+    if (fp > 0) count_fork();
     if (fp == 0) {
         close(pipe_fds[0]);
+        close(input_fds[0]);
         int devnull = open("/dev/null", O_WRONLY);
         if (devnull >= 0) { dup2(devnull, STDOUT_FILENO); dup2(devnull, STDERR_FILENO); }
-        frog_process(pipe_fds[1], start_rx, start_ry);
+        frog_process(input_fds[1], start_rx, start_ry);
         _exit(0);
     }
     if (frog_pid) *frog_pid = fp;
 
-    // Riforka creatore
-    pid_t cp = fork();
+    // Riforka creatore (o riparte la simulazione locale)
+    pid_t cp = start_croc_source();
     if (cp < 0) { endwin(); perror("fork"); exit(1); }
-    if (cp == 0) {
-        croc_creator(pipe_fds[1]);
-        _exit(0);
-    }
     if (creator_pid) *creator_pid = cp;
 
     // Re-init dati di gioco e prima manche
@@ -1687,5 +4100,1193 @@ static void full_cleanup(pid_t frog_pid, pid_t creator_pid) {
 
 // (Rimosso: il cleanup finale e il return vengono ora gestiti in full_cleanup e alla chiusura del main)
 
+// Cambi di contesto di tutto il sistema dall'avvio (riga "ctxt" di /proc/stat), -1 se non leggibile.
+// Conta anche i figli già uccisi, che getrusage(RUSAGE_CHILDREN) non vede se non raccolti.
+static long long system_ctxt_switches(void) {
+    FILE *f = fopen("/proc/stat", "r");
+    if (!f) return -1;
+    char line[256];
+    long long v = -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "ctxt %lld", &v) == 1) break;
+    }
+    fclose(f);
+    return v;
+}
+
+// Crea (o azzera) la regione condivisa dei contatori di sessione (ereditata dai figli col fork)
+static void stats_init(void) {
+    if (!shared_stats) {
+        void *mem = mmap(NULL, sizeof(SharedStats), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) return;      // statistiche non disponibili: il gioco funziona lo stesso
+        shared_stats = (SharedStats *)mem;
+    }
+    atomic_init(&shared_stats->forks, 0);
+    atomic_init(&shared_stats->msgs_sent, 0);
+    atomic_init(&shared_stats->spawns, 0);
+    atomic_init(&shared_stats->spawn_lat_sum, 0);
+    atomic_init(&shared_stats->spawn_lat_max, 0);
+    for (int k = 0; k < PRODUCER_KINDS; k++) {
+        atomic_init(&shared_stats->producers[k].sent, 0);
+        atomic_init(&shared_stats->producers[k].dropped, 0);
+        atomic_init(&shared_stats->producers[k].retried, 0);
+    }
+}
+
+// Messaggi saltati o persi da tutti i produttori
+static long long producers_dropped(void) {
+    long long d = 0;
+    for (int k = 0; shared_stats && k < PRODUCER_KINDS; k++) d += atomic_load(&shared_stats->producers[k].dropped);
+    return d;
+}
+
+// Contatori di controllo di flusso per tipo di produttore (stderr, a fine sessione)
+static void print_producer_stats(void) {
+    static const char *names[PRODUCER_KINDS] = { "coccodrilli", "proiettili", "rana" };
+    if (!shared_stats) return;
+    for (int k = 0; k < PRODUCER_KINDS; k++) {
+        ProducerStats *ps = &shared_stats->producers[k];
+        long long sent = atomic_load(&ps->sent), dropped = atomic_load(&ps->dropped);
+        fprintf(stderr, "  produttori %-11s inviati=%lld saltati=%lld (%.1f%%) ritentati=%lld\n", names[k],
+                sent, dropped, sent + dropped ? 100.0 * (double)dropped / (double)(sent + dropped) : 0.0,
+                (long long)atomic_load(&ps->retried));
+    }
+}
+
+// Picchi di occupazione e aggiornamenti persi delle arene (stderr, a fine partita)
+static void print_arena_stats(void) {
+    fprintf(stderr, "  coccodrilli: picco=%d cap=%d crescite=%d persi=%lld muti liberati=%lld\n",
+            croc_arena.high_water, croc_arena.cap, croc_arena.grows, croc_arena.dropped, stat_crocs_stale);
+    fprintf(stderr, "  proiettili:  picco=%d cap=%d crescite=%d persi=%lld\n",
+            projectile_arena.high_water, projectile_arena.cap, projectile_arena.grows, projectile_arena.dropped);
+}
+
+// Riepilogo di fine sessione su stderr (ncurses è già chiuso)
+static void print_session_stats(void) {
+    double secs = (double)(now_us() - session_start_us) / 1e6;
+    long long forks = shared_stats ? atomic_load(&shared_stats->forks) : -1;
+    long long sent = shared_stats ? atomic_load(&shared_stats->msgs_sent) : -1;
+    fprintf(stderr, "sessione: %.1f s, proiettili %s\n", secs,
+            PROJECTILE_PROCESSES ? "a processi" : "del padre");
+    if (uring_fallback_errno) {
+        fprintf(stderr, "  io_uring non disponibile (%s): usata la pipe con read()\n", strerror(uring_fallback_errno));
+    }
+    fprintf(stderr, "  fork=%lld  msg inviati=%lld  msg ricevuti=%lld (%.1f/s)\n",
+            forks, sent, stat_msgs_recv, secs > 0 ? (double)stat_msgs_recv / secs : 0.0);
+    if (transport_mode == TRANSPORT_SHM) {
+        fprintf(stderr, "  ring shm: celle saltate (produttore morto)=%lld\n", stat_shm_skipped);
+    }
+    if (sim_local) {
+        fprintf(stderr, "  coccodrilli simulati nel padre: partiti=%lld spari=%lld passi=%lld da %dms impronta=%016llx\n",
+                sim.spawned, sim.fired, sim.steps, SIM_STEP_US / 1000, (unsigned long long)sim.digest);
+    } else if (shared_stats) {
+        long long spawns = atomic_load(&shared_stats->spawns);
+        fprintf(stderr, "  coccodrilli %s: partiti=%lld latenza di spawn avg=%.0fus max=%lldus\n",
+                croc_lane_mode ? "a corsie" : croc_pool_enabled ? "dal pool" : "a fork singola", spawns,
+                spawns ? (double)atomic_load(&shared_stats->spawn_lat_sum) / (double)spawns : 0.0,
+                (long long)atomic_load(&shared_stats->spawn_lat_max));
+    }
+    fprintf(stderr, "  frame=%lld  tempo frame avg=%.1fus max=%lldus\n", stat_frames,
+            stat_frames ? (double)stat_frame_us_sum / (double)stat_frames : 0.0, stat_frame_us_max);
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    double cpu = (double)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) +
+                 (double)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+    long long ctxt = system_ctxt_switches();
+    fprintf(stderr, "  cambi di contesto: sistema=%lld (%.0f/s)  padre vol=%ld invol=%ld\n",
+            ctxt >= 0 && session_ctxt0 >= 0 ? ctxt - session_ctxt0 : -1LL,
+            ctxt >= 0 && session_ctxt0 >= 0 && secs > 0 ? (double)(ctxt - session_ctxt0) / secs : 0.0,
+            ru.ru_nvcsw, ru.ru_nivcsw);
+    fprintf(stderr, "  ciclo=%s  CPU padre=%.1f%%  input=%lld latenza input->schermo avg=%.1fms max=%.1fms\n",
+            loop_mode != LOOP_EPOLL ? "sleep" : transport_mode == TRANSPORT_URING ? "io_uring" : "epoll", secs > 0 ? 100.0 * cpu / secs : 0.0, stat_inputs,
+            stat_inputs ? (double)stat_input_lat_sum / (double)stat_inputs / 1000.0 : 0.0,
+            (double)stat_input_lat_max / 1000.0);
+    fprintf(stderr, "  figli: raccolta=%s  syscall di liveness=%lld (%.2f/frame)  raccolti=%lld\n",
+            reap_mode == REAP_POLL ? "polling" : "signalfd", stat_liveness_syscalls,
+            stat_frames ? (double)stat_liveness_syscalls / (double)stat_frames : 0.0, stat_children_reaped);
+    fprintf(stderr, "  coalescenza: posizioni=%lld scartate=%lld (%.1f%%)\n", stat_pos_msgs, stat_pos_skipped,
+            stat_pos_msgs ? 100.0 * (double)stat_pos_skipped / (double)stat_pos_msgs : 0.0);
+    fprintf(stderr, "  canale input: %lld tasti, ritardo in coda p50=%lldus p99=%lldus\n",
+            input_delay_n, input_delay_percentile(50), input_delay_percentile(99));
+#if BITBOARD_CHECK
+    fprintf(stderr, "  bitboard: disaccordi con le corsie=%lld\n", stat_bitboard_mismatch);
+#endif
+    if (transport_mode != TRANSPORT_SHM) {
+        fprintf(stderr, "  pipe: capacità=%d byte (%d msg)", pipe_capacity, pipe_capacity / (int)sizeof(msg));
+        if (pipe_size_req > 0) fprintf(stderr, " richiesti=%d%s%s", pipe_size_req,
+                                       pipe_size_errno ? " rifiutato: " : "", pipe_size_errno ? strerror(pipe_size_errno) : "");
+        fprintf(stderr, "  occupazione avg=%.0f max=%d byte (%.0f%%)\n    decili:",
+                stat_pipe_samples ? (double)stat_pipe_bytes_sum / (double)stat_pipe_samples : 0.0, stat_pipe_hwm,
+                pipe_capacity > 0 ? 100.0 * stat_pipe_hwm / pipe_capacity : 0.0);
+        for (int b = 0; b < PIPE_HIST_BUCKETS; b++) fprintf(stderr, " %lld", stat_pipe_hist[b]);
+        fprintf(stderr, "\n");
+    }
+    print_producer_stats();
+    print_arena_stats();
+}
+
+// Opzioni da riga di comando
+static void parse_args(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (strcmp(a, "--transport=pipe") == 0) {
+            transport_mode = TRANSPORT_PIPE;
+        } else if (strcmp(a, "--transport=shm") == 0) {
+            transport_mode = TRANSPORT_SHM;
+        } else if (strcmp(a, "--transport=uring") == 0) {
+            transport_mode = TRANSPORT_URING;
+        } else if (strncmp(a, "--spawn-ms=", 11) == 0) {
+            spawn_interval_ms = atoi(a + 11);
+        } else if (strcmp(a, "--croc-proto=pos") == 0) {
+            croc_protocol = CROC_PROTO_POS;
+        } else if (strcmp(a, "--croc-proto=dr") == 0) {
+            croc_protocol = CROC_PROTO_DR;
+        } else if (strncmp(a, "--crocs=", 8) == 0) {
+            max_active_crocs = atoi(a + 8);
+            if (max_active_crocs < 1) max_active_crocs = 1;
+        } else if (strcmp(a, "--stats") == 0) {
+            show_stats = 1;
+        } else if (strncmp(a, "--session-secs=", 15) == 0) {
+            session_secs = atoi(a + 15);
+            show_stats = 1;
+        } else if (strcmp(a, "--loop=sleep") == 0) {
+            loop_mode = LOOP_SLEEP;
+        } else if (strcmp(a, "--loop=epoll") == 0) {
+            loop_mode = LOOP_EPOLL;
+        } else if (strcmp(a, "--coalesce=off") == 0) {
+            coalesce_enabled = 0;
+        } else if (strcmp(a, "--flow=off") == 0) {
+            flow_control = 0;
+        } else if (strcmp(a, "--croc-pool=off") == 0) {
+            croc_pool_enabled = 0;
+        } else if (strcmp(a, "--croc-mode=lane") == 0) {
+            croc_lane_mode = 1;
+        } else if (strcmp(a, "--croc-mode=process") == 0) {
+            croc_lane_mode = 0;
+        } else if (strcmp(a, "--reap=poll") == 0) {
+            reap_mode = REAP_POLL;
+        } else if (strcmp(a, "--reap=signalfd") == 0) {
+            reap_mode = REAP_SIGNALFD;
+        } else if (strcmp(a, "--sim=local") == 0) {
+            sim_local = 1;
+        } else if (strcmp(a, "--sim=process") == 0) {
+            sim_local = 0;
+        } else if (strncmp(a, "--seed=", 7) == 0) {
+            sim_seed = strtoull(a + 7, NULL, 10);
+        } else if (strncmp(a, "--pipe-size=", 12) == 0) {
+            pipe_size_req = atoi(a + 12);
+        } else if (strncmp(a, "--bench=", 8) == 0) {
+            bench_name = a + 8;
+        } else {
+            fprintf(stderr,
+                    "uso: %s [--transport=pipe|shm|uring] [--croc-proto=pos|dr] [--spawn-ms=N] [--crocs=N] [--pipe-size=N]\n"
+                    "          [--loop=epoll|sleep] [--coalesce=off] [--flow=off] [--croc-pool=off] [--reap=signalfd|poll]\n"
+                    "          [--croc-mode=process|lane] [--sim=process|local] [--seed=N] [--stats] [--session-secs=N]\n"
+                    "          [--bench=transport|croc-proto|dispatch|collision|grenades|tunnel|input|coalesce|flow|lanes|sim|reap]\n", argv[0]);
+            exit(2);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark (senza ncurses): stampano i risultati su stdout ed escono
+// ---------------------------------------------------------------------------
+
+#define BENCH_PRODUCERS          8       // processi produttori simultanei
+#define BENCH_MSGS_PER_PRODUCER  50000   // messaggi inviati da ciascun produttore
+#define BENCH_TIMEOUT_MS         30000   // limite di sicurezza per un singolo giro
+
+// Un giro del benchmark di trasporto: BENCH_PRODUCERS figli inviano a raffica,
+// il padre drena a "frame" di al massimo MAX_MSGS_PER_FRAME messaggi come nel gioco
+static void bench_transport_run(int mode) {
+    transport_mode = mode;
+    if (transport_open() == -1) { perror("transport"); exit(1); }
+    int fl = fcntl(pipe_fds[0], F_GETFL, 0);
+    fcntl(pipe_fds[0], F_SETFL, fl | O_NONBLOCK);
+
+    pid_t kids[BENCH_PRODUCERS];
+    for (int p = 0; p < BENCH_PRODUCERS; p++) {
+        kids[p] = fork();
+        if (kids[p] == 0) {
+            close(pipe_fds[0]);
+            msg m = { .id = OBJ_CROC, .x = 0, .y = p, .pid = getpid(), .x_speed = 1, .t_us = 0 };
+            for (int k = 0; k < BENCH_MSGS_PER_PRODUCER; k++) {
+                m.x = k;
+                while (transport_send(pipe_fds[1], &m) < 0) {
+                    if (errno != EAGAIN && errno != EWOULDBLOCK) _exit(1);
+                    usleep(50);            // ring pieno: lascia lavorare il padre
+                }
+            }
+            _exit(0);
+        }
+    }
+
+    const long long total = (long long)BENCH_PRODUCERS * BENCH_MSGS_PER_PRODUCER;
+    long long received = 0, frames = 0, drain_us_sum = 0, drain_us_max = 0, syscalls = 0;
+    long long t0 = now_us();
+    while (received < total && now_us() - t0 < BENCH_TIMEOUT_MS * 1000LL) {
+        msg batch[MAX_MSGS_PER_FRAME];
+        frame_recv_syscalls = 0;
+        long long f0 = now_us();
+        int drained = transport_recv_batch(batch, MAX_MSGS_PER_FRAME);
+        long long dt = now_us() - f0;
+        syscalls += frame_recv_syscalls;
+        if (drained < 0) break;
+        if (drained == 0) {
+            transport_wait(16);            // niente da drenare: aspetta il prossimo messaggio
+            continue;
+        }
+        received += drained;
+        frames++;
+        drain_us_sum += dt;
+        if (dt > drain_us_max) drain_us_max = dt;
+    }
+    long long elapsed_us = now_us() - t0;
+
+    for (int p = 0; p < BENCH_PRODUCERS; p++) {
+        kill(kids[p], SIGKILL);
+        waitpid(kids[p], NULL, 0);
+    }
+    cleanup_pipes();
+
+    printf("%-5s  msgs=%lld/%lld  msgs/s=%.0f  frames=%lld  drain/frame avg=%.1fus max=%lldus  per msg=%.0fns  read()=%lld\n",
+           mode == TRANSPORT_SHM ? "shm" : transport_mode == TRANSPORT_URING ? "uring" : "pipe", received, total,
+           elapsed_us > 0 ? (double)received * 1e6 / (double)elapsed_us : 0.0,
+           frames, frames ? (double)drain_us_sum / (double)frames : 0.0, drain_us_max,
+           received ? (double)drain_us_sum * 1000.0 / (double)received : 0.0, syscalls);
+}
+
+#define BENCH_CROC_SECS          8       // durata di ogni giro del benchmark protocollo coccodrilli
+#define BENCH_CROC_SPAWN_MS      100     // ritmo di spawn se non indicato con --spawn-ms
+
+// Un giro del benchmark di protocollo: il vero croc_creator gira per BENCH_CROC_SECS
+// e il padre conta i messaggi ricevuti (coccodrilli e totali) al secondo
+static void bench_croc_proto_run(int proto) {
+    croc_protocol = proto;
+    if (transport_open() == -1) { perror("transport"); exit(1); }
+    int fl = fcntl(pipe_fds[0], F_GETFL, 0);
+    fcntl(pipe_fds[0], F_SETFL, fl | O_NONBLOCK);
+
+    pid_t creator = fork();
+    if (creator == 0) {
+        setpgid(0, 0);                     // creatore e coccodrilli in un gruppo da uccidere insieme
+        croc_creator(pipe_fds[1]);
+        _exit(0);
+    }
+    setpgid(creator, creator);
+
+    long long croc_msgs = 0, all_msgs = 0;
+    long long t0 = now_us();
+    while (now_us() - t0 < BENCH_CROC_SECS * 1000000LL) {
+        msg batch[MAX_MSGS_PER_FRAME];
+        int n = transport_recv_batch(batch, MAX_MSGS_PER_FRAME);
+        if (n < 0) break;
+        for (int k = 0; k < n; k++) {
+            int id = batch[k].id;
+            if (id == OBJ_CROC || id == OBJ_CROC_SPAWN || id == OBJ_CROC_DESPAWN) croc_msgs++;
+        }
+        all_msgs += n;
+        if (n == 0) transport_wait(16);
+    }
+    double secs = (double)(now_us() - t0) / 1e6;
+
+    kill(-creator, SIGKILL);
+    waitpid(creator, NULL, 0);
+    cleanup_pipes();
+
+    printf("%-3s  croc msgs/s=%.1f  tutti msgs/s=%.1f\n",
+           proto == CROC_PROTO_DR ? "dr" : "pos", (double)croc_msgs / secs, (double)all_msgs / secs);
+}
+
+#define BENCH_DISPATCH_MSGS      2000000 // messaggi OBJ_CROC smistati per ogni misura
+
+// Riferimento per il benchmark: la vecchia ricerca lineare dello slot per pid
+static CrocState* bench_find_croc_linear(pid_t pid) {
+    for (int i = 0; i < croc_arena.cap; i++) {
+        if (crocs[i].in_use && crocs[i].pid == pid) return &crocs[i];
+    }
+    return NULL;
+}
+
+#define BENCH_DISPATCH_MAX_LIVE  4096    // coccodrilli vivi nella misura più grande
+
+// Costo di smistamento di un messaggio OBJ_CROC in funzione dei coccodrilli vivi
+static void bench_dispatch(void) {
+    printf("dispatch: %d messaggi OBJ_CROC per misura\n", BENCH_DISPATCH_MSGS);
+    for (int live = 1; live <= BENCH_DISPATCH_MAX_LIVE; live *= 2) {
+        reset_entity_tables();
+        // Libera uno slot ogni due dopo averli riempiti: l'indice lavora con buchi e backward shift
+        for (int k = 0; k < live * 2; k++) get_croc_slot(1000 + 7 * k);
+        for (int k = 1; k < live * 2; k += 2) {
+            release_croc_slot((int)(pid_index_find(&croc_arena.index, 1000 + 7 * k) & HANDLE_SLOT_MASK));
+        }
+        int n = 0;
+        pid_t pids[BENCH_DISPATCH_MAX_LIVE];
+        for (int i = 0; i < croc_arena.cap; i++) if (crocs[i].in_use) pids[n++] = crocs[i].pid;
+
+        msg m = { .id = OBJ_CROC, .x = 0, .y = Y_FIUME, .pid = 0, .x_speed = 1, .t_us = 0 };
+        long long t0 = now_us();
+        for (int k = 0; k < BENCH_DISPATCH_MSGS; k++) {
+            m.pid = pids[k % n];
+            m.x = k & 63;
+            apply_croc_position(&m);
+        }
+        long long t_index = now_us() - t0;
+
+        volatile int sink = 0;
+        t0 = now_us();
+        for (int k = 0; k < BENCH_DISPATCH_MSGS; k++) {
+            CrocState *cs = bench_find_croc_linear(pids[k % n]);
+            if (cs) sink += cs->pos;
+        }
+        long long t_linear = now_us() - t0;
+        (void)sink;
+
+        printf("  vivi=%5d  indice=%6.1f ns/msg  scansione lineare=%8.1f ns/msg\n", n,
+               (double)t_index * 1000.0 / BENCH_DISPATCH_MSGS, (double)t_linear * 1000.0 / BENCH_DISPATCH_MSGS);
+    }
+}
+
+#define BENCH_COLLISION_PASSES   200000  // passate di collisione per ogni misura
+#define BENCH_COLLISION_FIELD_W  1000    // colonne su cui sono sparse le entità
+
+// Riferimento per il benchmark di collisione: il vecchio layout AoS, con buchi, scandito tutto
+typedef struct {
+    int in_use;
+    int x, y;
+    int dx_frame;
+    int id;
+    int direction;
+} BenchAosEntity;
+
+static bool bench_aos_frog_on_croc(const BenchAosEntity *c, int cap, int *out_dx) {
+    for (int i = 0; i < cap; i++) {
+        if (!c[i].in_use || c[i].y != frog_y) continue;
+        if (frog_x <= c[i].x + CROC_W - 1 && frog_x + FROG_W - 1 >= c[i].x) {
+            *out_dx = c[i].dx_frame;
+            return true;
+        }
+    }
+    return false;
+}
+
+static int bench_aos_projectile_hit(const BenchAosEntity *p, int cap) {
+    for (int i = 0; i < cap; i++) {
+        if (!p[i].in_use || p[i].id != OBJ_PROJECTILE) continue;
+        if (p[i].x >= frog_x && p[i].x < frog_x + FROG_W && p[i].y >= frog_y && p[i].y < frog_y + FROG_H) return i;
+    }
+    return -1;
+}
+
+// Costo della passata di collisione della rana (su coccodrillo? colpita?) con n coccodrilli
+// e n proiettili sugli 8 flussi: corsie SoA ordinate contro scansione completa dell'AoS
+static void bench_collision(void) {
+    static const int sizes[] = { 16, 256, 4096 };
+    printf("collision: %d passate (rana su croc + proiettili) per misura\n", BENCH_COLLISION_PASSES);
+    srand(12345);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int n = sizes[s];
+        reset_entity_tables();
+        // L'AoS di riferimento ha uno slot libero ogni due, come un'arena dopo qualche rilascio
+        BenchAosEntity *aos_c = calloc((size_t)2 * n, sizeof(BenchAosEntity));
+        BenchAosEntity *aos_p = calloc((size_t)2 * n, sizeof(BenchAosEntity));
+        if (!aos_c || !aos_p) {
+            free(aos_c);
+            free(aos_p);
+            return;
+        }
+        for (int k = 0; k < n; k++) {
+            int y = flow_to_y(k % N_FLUSSI);
+            int cx = rand() % BENCH_COLLISION_FIELD_W;
+            int px = rand() % BENCH_COLLISION_FIELD_W;
+            msg m = { .id = OBJ_CROC, .x = cx, .y = y, .pid = 1000 + k, .x_speed = 1, .t_us = 0 };
+            apply_croc_position(&m);
+            spawn_analytic_projectile(px, y, 1, OBJ_PROJECTILE, 0);
+            aos_c[2 * k + 1] = (BenchAosEntity){ 1, cx, y, 0, OBJ_CROC, 0 };
+            aos_p[2 * k + 1] = (BenchAosEntity){ 1, px, y, 0, OBJ_PROJECTILE, 1 };
+        }
+        sort_entity_lanes();
+        rebuild_collision_bitboards();
+
+        volatile long long sink = 0;
+        long long t0 = now_us();
+        for (int k = 0; k < BENCH_COLLISION_PASSES; k++) {
+            frog_x = frog_prev_x = (k * 37) % BENCH_COLLISION_FIELD_W;
+            frog_y = flow_to_y(k % N_FLUSSI);
+            int dx = 0;
+            sink += is_frog_on_croc(&dx) + dx + find_projectile_hitting_frog();
+        }
+        long long t_lanes = now_us() - t0;
+
+        t0 = now_us();
+        for (int k = 0; k < BENCH_COLLISION_PASSES; k++) {
+            frog_x = frog_prev_x = (k * 37) % BENCH_COLLISION_FIELD_W;
+            frog_y = flow_to_y(k % N_FLUSSI);
+            int dx = 0;
+            sink += bench_aos_frog_on_croc(aos_c, 2 * n, &dx) + dx + bench_aos_projectile_hit(aos_p, 2 * n);
+        }
+        long long t_aos = now_us() - t0;
+
+        t0 = now_us();
+        for (int k = 0; k < BENCH_COLLISION_PASSES; k++) {
+            frog_x = frog_prev_x = (k * 37) % BENCH_COLLISION_FIELD_W;
+            frog_y = flow_to_y(k % N_FLUSSI);
+            sink += bitboard_frog_on_croc() + bitboard_projectile_hits_frog();
+        }
+        long long t_bits = now_us() - t0;
+        t0 = now_us();
+        rebuild_collision_bitboards();
+        long long t_rebuild = now_us() - t0;
+
+        // Le bitboard coprono solo il campo: la rana resta dentro, come in gioco
+        int mismatch = 0;
+        for (int k = 0; k < BENCH_COLLISION_PASSES; k++) {
+            frog_x = frog_prev_x = 1 + (k * 37) % (GAME_WIDTH - FROG_W - 1);
+            frog_y = flow_to_y(k % N_FLUSSI);
+            if (bitboard_frog_on_croc() != is_frog_on_croc(NULL)) mismatch++;
+            if (!bitboard_projectile_hits_frog() && find_projectile_hitting_frog() >= 0) mismatch++;
+        }
+        (void)sink;
+
+        printf("  entità=%5d+%-5d  corsie SoA=%7.1f ns/passata  AoS scansione=%8.1f ns/passata\n", n, n,
+               (double)t_lanes * 1000.0 / BENCH_COLLISION_PASSES, (double)t_aos * 1000.0 / BENCH_COLLISION_PASSES);
+        printf("  %12s  bitboard=%7.1f ns/passata (ricostruzione %lld us/frame)  disaccordi=%d\n", "",
+               (double)t_bits * 1000.0 / BENCH_COLLISION_PASSES, t_rebuild, mismatch);
+        free(aos_c);
+        free(aos_p);
+    }
+    reset_entity_tables();
+}
+
+#define BENCH_GRENADE_REPS  200    // ripetizioni del controllo per ogni misura
+
+// Riferimento: il vecchio doppio ciclo su tutti gli slot (AoS con buchi), stessa regola
+// di rimozione; restituisce quante entità verrebbero rimosse
+static int bench_aos_grenade_vs_projectile(BenchAosEntity *e, int cap) {
+    for (int i = 0; i < cap; i++) {
+        if (!e[i].in_use || abs(e[i].id) != OBJ_GRENADE) continue;
+        for (int j = 0; j < cap; j++) {
+            if (!e[j].in_use || abs(e[j].id) != OBJ_PROJECTILE || e[i].y != e[j].y) continue;
+            if (!grenade_hits_projectile(e[i].x, e[i].direction, e[j].x, e[j].direction)) continue;
+            e[i].id = -OBJ_GRENADE;
+            e[j].id = -OBJ_PROJECTILE;
+        }
+    }
+    int removed = 0;
+    for (int i = 0; i < cap; i++) {
+        if (e[i].in_use && e[i].id < 0) {
+            e[i].in_use = 0;
+            removed++;
+        }
+    }
+    return removed;
+}
+
+// Stress di check_grenade_vs_projectile(): n proiettili (metà granate, metà dei coccodrilli)
+// sparsi sugli N_FLUSSI flussi del campo, direzioni casuali
+static void bench_grenades(void) {
+    static const int sizes[] = { 128, 512, 2048 };
+    printf("grenades: %d controlli per misura, proiettili sugli %d flussi (%d colonne)\n",
+           BENCH_GRENADE_REPS, N_FLUSSI, GAME_WIDTH - 2);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int n = sizes[s];
+        BenchAosEntity *src = malloc((size_t)n * sizeof(BenchAosEntity));
+        BenchAosEntity *aos = malloc((size_t)2 * n * sizeof(BenchAosEntity));
+        if (!src || !aos) {
+            free(src);
+            free(aos);
+            return;
+        }
+        long long t_sweep = 0, t_aos = 0, removed_sweep = 0, removed_aos = 0;
+        srand(777);
+        for (int r = 0; r < BENCH_GRENADE_REPS; r++) {
+            for (int k = 0; k < n; k++) {
+                src[k] = (BenchAosEntity){ 1, 1 + rand() % (GAME_WIDTH - 2), flow_to_y(rand() % N_FLUSSI), 0,
+                                           (k % 2) ? OBJ_PROJECTILE : OBJ_GRENADE, (rand() % 2) ? 1 : -1 };
+            }
+
+            reset_entity_tables();
+            for (int k = 0; k < n; k++) spawn_analytic_projectile(src[k].x, src[k].y, src[k].direction, src[k].id, 0);
+            sort_entity_lanes();
+            int before = projectile_arena.live;
+            long long t0 = now_us();
+            check_grenade_vs_projectile();
+            t_sweep += now_us() - t0;
+            removed_sweep += before - projectile_arena.live;
+
+            // L'AoS di riferimento ha uno slot libero ogni due, come un'arena dopo qualche rilascio
+            memset(aos, 0, (size_t)2 * n * sizeof(BenchAosEntity));
+            for (int k = 0; k < n; k++) aos[2 * k + 1] = src[k];
+            t0 = now_us();
+            removed_aos += bench_aos_grenade_vs_projectile(aos, 2 * n);
+            t_aos += now_us() - t0;
+        }
+        printf("  proiettili=%5d  sweep=%8.1f us/frame  doppio ciclo=%9.1f us/frame  rimossi %lld / %lld\n", n,
+               (double)t_sweep / BENCH_GRENADE_REPS, (double)t_aos / BENCH_GRENADE_REPS, removed_sweep, removed_aos);
+        free(src);
+        free(aos);
+    }
+    reset_entity_tables();
+}
+
+// Avanza di step colonne (nel verso di ogni proiettile) tutti i proiettili di una corsia,
+// come farebbe un frame con aggiornamenti più radi
+static void bench_tunnel_step(int lane, int step) {
+    begin_frame_lanes();
+    ProjectileLane *L = &projectile_lanes[lane];
+    for (int p = 0; p < L->n; p++) projectile_lane_set_x(L, p, L->x[p] + L->direction[p] * step);
+    sort_entity_lanes();
+    rebuild_collision_bitboards();
+}
+
+// Tunnelling: a step colonne per frame, per ogni fase di partenza, quante volte il
+// proiettile viene rilevato sulla rana e quante volte granata e proiettile in rotta di
+// collisione si annullano; confronto con il vecchio controllo a campioni (solo posizione finale)
+static void bench_tunnel(void) {
+    static const int steps[] = { 1, 2, 3, 4, 6, 8 };
+    int y = flow_to_y(0);
+    int lane = lane_of_y(y);
+    printf("tunnel: colonne per frame, rilevamenti su tutte le fasi di partenza (tratti / campioni)\n");
+    for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) {
+        int step = steps[s];
+        int frog_swept = 0, frog_sampled = 0, gren_swept = 0, gren_sampled = 0;
+        for (int phase = 0; phase < step; phase++) {
+            // Proiettile verso la rana ferma in x=50
+            reset_entity_tables();
+            frog_x = frog_prev_x = 50;
+            frog_y = y;
+            spawn_analytic_projectile(20 + phase, y, +1, OBJ_PROJECTILE, 0);
+            bool swept = false, sampled = false;
+            for (int f = 0; f < 60 / step; f++) {
+                bench_tunnel_step(lane, step);
+                if (bitboard_projectile_hits_frog() && find_projectile_hitting_frog() >= 0) swept = true;
+                int x = projectile_lanes[lane].x[0];
+                if (x >= frog_x && x < frog_x + FROG_W) sampled = true;
+            }
+            frog_swept += swept;
+            frog_sampled += sampled;
+
+            // Granata e proiettile che si vengono incontro
+            reset_entity_tables();
+            spawn_analytic_projectile(20 + phase, y, +1, OBJ_GRENADE, 0);
+            spawn_analytic_projectile(80, y, -1, OBJ_PROJECTILE, 0);
+            int gx = 20 + phase, px = 80;
+            swept = false;
+            sampled = false;
+            for (int f = 0; f < 60 / step && !swept; f++) {
+                bench_tunnel_step(lane, step);
+                check_grenade_vs_projectile();
+                if (projectile_arena.live == 0) swept = true;
+                gx += step;
+                px -= step;
+                if (grenade_hits_projectile(gx, +1, px, -1)) sampled = true;
+            }
+            gren_swept += swept;
+            gren_sampled += sampled;
+        }
+
+        // Rana che salta verso il proiettile con due tasti nello stesso frame (acc_dx li somma:
+        // 2*FROG_W colonne): a fine frame possono non sovrapporsi mai. Confronto con il solo
+        // tratto del proiettile sulla rana finale
+        int hop = 2 * FROG_W;
+        int hop_phases = step + hop, hop_swept = 0, hop_bullet_only = 0;
+        for (int phase = 0; phase < hop_phases; phase++) {
+            reset_entity_tables();
+            frog_x = frog_prev_x = 80;
+            frog_y = y;
+            spawn_analytic_projectile(20 + phase, y, +1, OBJ_PROJECTILE, 0);
+            bool swept = false, bullet_only = false;
+            while (frog_x - hop >= 1 && !swept) {
+                bench_tunnel_step(lane, step);
+                frog_prev_x = frog_x;
+                frog_x -= hop;
+                if (bitboard_projectile_hits_frog() && find_projectile_hitting_frog() >= 0) swept = true;
+                const ProjectileLane *L = &projectile_lanes[lane];
+                int a = (L->prev_x[0] < L->x[0]) ? L->prev_x[0] : L->x[0];
+                int b = (L->prev_x[0] < L->x[0]) ? L->x[0] : L->prev_x[0];
+                if (a <= frog_x + FROG_W - 1 && b >= frog_x) bullet_only = true;
+            }
+            hop_swept += swept;
+            hop_bullet_only += bullet_only;
+        }
+
+        // Proiettile che insegue da dietro una rana più veloce (step+1 colonne per frame):
+        // non la raggiunge mai. Confronto con la sola sovrapposizione degli intervalli percorsi
+        int chase_phases = step, chase_hits = 0, chase_spans = 0;
+        for (int phase = 0; phase < chase_phases; phase++) {
+            reset_entity_tables();
+            frog_x = frog_prev_x = 20;
+            frog_y = y;
+            spawn_analytic_projectile(frog_x - 1 - phase, y, +1, OBJ_PROJECTILE, 0);
+            bool hit = false, span = false;
+            while (frog_x + (step + 1) + FROG_W < GAME_WIDTH - 1) {
+                bench_tunnel_step(lane, step);
+                frog_prev_x = frog_x;
+                frog_x += step + 1;
+                if (bitboard_projectile_hits_frog() && find_projectile_hitting_frog() >= 0) hit = true;
+                int lo, hi;
+                frog_swept_span(&lo, &hi);
+                const ProjectileLane *L = &projectile_lanes[lane];
+                int a = (L->prev_x[0] < L->x[0]) ? L->prev_x[0] : L->x[0];
+                int b = (L->prev_x[0] < L->x[0]) ? L->x[0] : L->prev_x[0];
+                if (a <= hi && b >= lo) span = true;
+            }
+            chase_hits += hit;
+            chase_spans += span;
+        }
+        printf("  passo=%d  proiettile->rana %d/%d (campioni %d/%d)  granata<->proiettile %d/%d (campioni %d/%d)"
+               "  rana in salto %d/%d (senza tratto della rana %d/%d)"
+               "  inseguita da dietro %d/%d (intervalli %d/%d)\n",
+               step, frog_swept, step, frog_sampled, step, gren_swept, step, gren_sampled, step,
+               hop_swept, hop_phases, hop_bullet_only, hop_phases, chase_hits, chase_phases, chase_spans, chase_phases);
+    }
+    reset_entity_tables();
+}
+
+#define BENCH_INPUT_SECS       3         // durata di ogni giro
+#define BENCH_INPUT_FLOODERS   4         // produttori che saturano il canale principale
+#define BENCH_INPUT_KEY_MS     20        // un tasto ogni 20 ms
+
+// Ritardo in coda dei tasti con il canale principale saturo: tasti sulla stessa pipe dei
+// coccodrilli (own=0) oppure sul canale input drenato per primo (own=1). Il padre drena a
+// frame da MAX_MSGS_PER_FRAME messaggi ogni FRAME_US, come nel gioco con --loop=sleep.
+static void bench_input_run(int own) {
+    transport_mode = TRANSPORT_PIPE;
+    if (transport_open() == -1) { perror("transport"); exit(1); }
+    int fl = fcntl(pipe_fds[0], F_GETFL, 0);
+    fcntl(pipe_fds[0], F_SETFL, fl | O_NONBLOCK);
+    input_delay_n = 0;
+
+    pid_t kids[BENCH_INPUT_FLOODERS + 1];
+    for (int p = 0; p <= BENCH_INPUT_FLOODERS; p++) {
+        kids[p] = fork();
+        if (kids[p] != 0) continue;
+        close(pipe_fds[0]);
+        close(input_fds[0]);
+        long long end = now_us() + BENCH_INPUT_SECS * 1000000LL;
+        msg m = { .id = OBJ_CROC, .x = 0, .y = p, .pid = getpid(), .x_speed = 1, .t_us = 0 };
+        if (p == BENCH_INPUT_FLOODERS) {
+            // "rana": un tasto ogni BENCH_INPUT_KEY_MS
+            m.id = OBJ_RANA;
+            while (now_us() < end) {
+                if (own) {
+                    input_send(input_fds[1], &m);
+                } else {
+                    m.t_us = now_us();
+                    ssize_t wr = write(pipe_fds[1], &m, sizeof(m)); // bloccante se la pipe è piena
+                    (void)wr;
+                }
+                usleep(BENCH_INPUT_KEY_MS * 1000);
+            }
+        } else {
+            while (now_us() < end) {
+                ssize_t wr = write(pipe_fds[1], &m, sizeof(m));
+                (void)wr;
+            }
+        }
+        _exit(0);
+    }
+    close(input_fds[1]);
+    input_fds[1] = -1;
+
+    long long t0 = now_us();
+    while (now_us() - t0 < (BENCH_INPUT_SECS + 1) * 1000000LL) {
+        msg batch[INPUT_MAX_PER_FRAME + MAX_MSGS_PER_FRAME];
+        int n = own ? input_recv_batch(batch, INPUT_MAX_PER_FRAME) : 0;
+        int got = transport_recv_batch(batch + n, MAX_MSGS_PER_FRAME);
+        if (got < 0) break;                 // tutti i produttori hanno chiuso
+        if (!own) {
+            long long t = now_us();
+            for (int k = 0; k < got; k++) {
+                if (batch[k].id != OBJ_RANA) continue;
+                input_delay_us[input_delay_n % INPUT_DELAY_SAMPLES] = t - batch[k].t_us;
+                input_delay_n++;
+            }
+        }
+        usleep(FRAME_US);
+    }
+    for (int p = 0; p <= BENCH_INPUT_FLOODERS; p++) {
+        kill(kids[p], SIGKILL);
+        waitpid(kids[p], NULL, 0);
+    }
+    cleanup_pipes();
+    printf("  %-8s tasti=%3lld  ritardo in coda p50=%8.1f ms  p99=%8.1f ms\n", own ? "input" : "condiviso",
+           input_delay_n, input_delay_percentile(50) / 1000.0, input_delay_percentile(99) / 1000.0);
+}
+
+#define BENCH_COALESCE_REPS  2000        // batch smistati per ogni misura
+
+// Somma di x e dx_frame di tutti i coccodrilli: firma dello stato dopo lo smistamento
+static long long bench_croc_state_sum(void) {
+    long long s = 0;
+    for (int lane = 0; lane < LANE_BUCKETS; lane++) {
+        for (int p = 0; p < croc_lanes[lane].n; p++) s += croc_lanes[lane].x[p] * 1000LL + croc_lanes[lane].dx_frame[p];
+    }
+    return s;
+}
+
+// Padre in ritardo: batch da MAX_MSGS_PER_FRAME posizioni OBJ_CROC di n coccodrilli, ognuno
+// con depth aggiornamenti arretrati interlacciati. Smistamento completo contro coalescenza.
+static void bench_coalesce(void) {
+    static const int depths[] = { 1, 4, 16 };
+    printf("coalesce: batch da %d posizioni, %d batch per misura\n", MAX_MSGS_PER_FRAME, BENCH_COALESCE_REPS);
+    static msg batch[MAX_MSGS_PER_FRAME];
+    static bool skip[MAX_MSGS_PER_FRAME];
+    for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+        int depth = depths[d];
+        int n = MAX_MSGS_PER_FRAME / depth;
+        for (int k = 0; k < MAX_MSGS_PER_FRAME; k++) {
+            int c = k % n, step = k / n;
+            batch[k] = (msg){ .id = OBJ_CROC, .x = c + step, .y = flow_to_y(c % N_FLUSSI), .pid = 1000 + c,
+                              .x_speed = 1, .t_us = 0 };
+        }
+        long long t_all = 0, t_coal = 0, sum_all = 0, sum_coal = 0;
+        int applied = 0;
+        for (int pass = 0; pass < 2; pass++) {
+            reset_entity_tables();
+            for (int c = 0; c < n; c++) apply_croc_position(&batch[c]); // coccodrilli già noti
+            for (int r = 0; r < BENCH_COALESCE_REPS; r++) {
+                begin_frame_lanes();
+                long long t0 = now_us();
+                if (pass == 1) coalesce_positions(batch, MAX_MSGS_PER_FRAME, skip);
+                int a = 0;
+                for (int k = 0; k < MAX_MSGS_PER_FRAME; k++) {
+                    if (pass == 1 && skip[k]) continue;
+                    apply_croc_position(&batch[k]);
+                    a++;
+                }
+                sort_entity_lanes();
+                if (pass == 0) t_all += now_us() - t0; else t_coal += now_us() - t0;
+                if (pass == 1) applied = a;
+                // riporta i coccodrilli all'inizio, come se il batch successivo ripartisse da lì
+                if (r + 1 < BENCH_COALESCE_REPS) {
+                    for (int c = 0; c < n; c++) apply_croc_position(&batch[c]);
+                }
+            }
+            if (pass == 0) sum_all = bench_croc_state_sum(); else sum_coal = bench_croc_state_sum();
+        }
+        printf("  coccodrilli=%3d x %2d arretrati  tutti=%6.1f us/batch  coalescenza=%6.1f us/batch"
+               "  applicati %d/%d  stato %s\n", n, depth, (double)t_all / BENCH_COALESCE_REPS,
+               (double)t_coal / BENCH_COALESCE_REPS, applied, MAX_MSGS_PER_FRAME,
+               sum_all == sum_coal ? "identico" : "DIVERSO");
+    }
+    reset_entity_tables();
+}
+
+#define BENCH_FLOW_STALL_MS  4000        // padre fermo: non legge nulla
+#define BENCH_FLOW_DRAIN_MS  2000        // poi drena a frame come nel gioco
+#define BENCH_FLOW_CROCS     200         // coccodrilli vivi al massimo durante la misura
+#define BENCH_FLOW_SPAWN_MS  5
+
+// Passi dei coccodrilli finora (consegnati + saltati)
+static long long bench_croc_steps(void) {
+    ProducerStats *ps = &shared_stats->producers[PRODUCER_CROC];
+    return atomic_load(&ps->sent) + atomic_load(&ps->dropped);
+}
+
+// Saturazione: il vero croc_creator gira mentre il padre resta fermo per BENCH_FLOW_STALL_MS
+// (la pipe si riempie), poi drena. Con la write-end bloccante i coccodrilli si fermano
+// sulla write(); con il controllo di flusso continuano a muoversi saltando posizioni.
+static void bench_flow_run(int on) {
+    flow_control = on;
+    stats_init();
+    if (!shared_stats) { perror("mmap"); exit(1); }
+    if (transport_open() == -1) { perror("transport"); exit(1); }
+    int fl = fcntl(pipe_fds[0], F_GETFL, 0);
+    fcntl(pipe_fds[0], F_SETFL, fl | O_NONBLOCK);
+
+    pid_t creator = fork();
+    if (creator == 0) {
+        setpgid(0, 0);
+        croc_creator(pipe_fds[1]);
+        _exit(0);
+    }
+    setpgid(creator, creator);
+    // con --flow=off i coccodrilli scrivono bloccando: si contano i passi dal padre
+    long long t0 = now_us();
+    usleep(BENCH_FLOW_STALL_MS * 1000);
+    long long stall_msgs = 0, drain_msgs = 0;
+    msg batch[MAX_MSGS_PER_FRAME];
+    int n;
+    // quanto è stato prodotto durante lo stallo: tutto ciò che è in pipe più i passi saltati
+    while ((n = transport_recv_batch(batch, MAX_MSGS_PER_FRAME)) > 0) stall_msgs += n;
+    long long stall_steps = on ? bench_croc_steps() : stall_msgs;
+    long long t1 = now_us();
+    while (now_us() - t1 < BENCH_FLOW_DRAIN_MS * 1000LL) {
+        n = transport_recv_batch(batch, MAX_MSGS_PER_FRAME);
+        if (n < 0) break;
+        drain_msgs += n;
+        usleep(FRAME_US);
+    }
+    double stall_s = (double)(t1 - t0) / 1e6, drain_s = (double)(now_us() - t1) / 1e6;
+    kill(-creator, SIGKILL);
+    waitpid(creator, NULL, 0);
+    cleanup_pipes();
+
+    ProducerStats *ps = &shared_stats->producers[PRODUCER_CROC];
+    printf("  %-7s stallo: %6.0f passi/s (in pipe %lld)  dopo: %6.0f msg/s  saltati=%lld ritentati=%lld\n",
+           on ? "flusso" : "blocca", (double)stall_steps / stall_s, stall_msgs, (double)drain_msgs / drain_s,
+           on ? (long long)atomic_load(&ps->dropped) : 0LL, on ? (long long)atomic_load(&ps->retried) : 0LL);
+}
+
+#define BENCH_LANES_SECS     12          // durata di ogni giro
+#define BENCH_LANES_WARMUP   3           // secondi esclusi dalla misura (il fiume si popola)
+#define BENCH_LANES_CROCS    32          // 4 per corsia: la densità che le corsie reggono senza sovrapporli
+#define BENCH_LANES_SPAWN_MS 5
+
+// Cambi di contesto (volontari + involontari) dei processi vivi del gruppo pgid, da /proc
+static long long group_ctxt_switches(pid_t pgid) {
+    DIR *d = opendir("/proc");
+    if (!d) return -1;
+    long long total = 0;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        if (e->d_name[0] < '0' || e->d_name[0] > '9') continue;
+        char path[300], line[128];
+        snprintf(path, sizeof(path), "/proc/%s/stat", e->d_name);
+        FILE *f = fopen(path, "r");
+        if (!f) continue;
+        int pgrp = -1;
+        // pid (comm) stato ppid pgrp: comm non contiene spazi per questo programma
+        if (fscanf(f, "%*d %*s %*c %*d %d", &pgrp) != 1) pgrp = -1;
+        fclose(f);
+        if (pgrp != pgid) continue;
+        snprintf(path, sizeof(path), "/proc/%s/status", e->d_name);
+        f = fopen(path, "r");
+        if (!f) continue;
+        long long v;
+        while (fgets(line, sizeof(line), f)) {
+            if (sscanf(line, "voluntary_ctxt_switches: %lld", &v) == 1 ||
+                sscanf(line, "nonvoluntary_ctxt_switches: %lld", &v) == 1) total += v;
+        }
+        fclose(f);
+    }
+    closedir(d);
+    return total;
+}
+
+// Un giro: il vero croc_creator nella modalità indicata, il padre drena a cadenza di frame.
+// Cambi di contesto di tutto il sistema (/proc/stat) e dei soli produttori (gruppo del creatore;
+// i coccodrilli a fork singola usciti durante la misura perdono i loro).
+static void bench_lanes_run(int lane_mode, int pool) {
+    croc_lane_mode = lane_mode;
+    croc_pool_enabled = pool;
+    stats_init();
+    if (transport_open() == -1) { perror("transport"); exit(1); }
+    int fl = fcntl(pipe_fds[0], F_GETFL, 0);
+    fcntl(pipe_fds[0], F_SETFL, fl | O_NONBLOCK);
+
+    pid_t creator = fork();
+    if (creator == 0) {
+        setpgid(0, 0);
+        croc_creator(pipe_fds[1]);
+        _exit(0);
+    }
+    setpgid(creator, creator);
+    count_fork();
+
+    long long t0 = now_us(), t_meas = -1, ctxt0 = 0, prod0 = 0, pos_msgs = 0;
+    while (now_us() - t0 < BENCH_LANES_SECS * 1000000LL) {
+        if (t_meas < 0 && now_us() - t0 >= BENCH_LANES_WARMUP * 1000000LL) {
+            t_meas = now_us();
+            ctxt0 = system_ctxt_switches();
+            prod0 = group_ctxt_switches(creator);
+            pos_msgs = 0;
+        }
+        msg batch[MAX_MSGS_PER_FRAME];
+        int n = transport_recv_batch(batch, MAX_MSGS_PER_FRAME);
+        if (n < 0) break;
+        for (int k = 0; k < n; k++) {
+            if (batch[k].id == OBJ_CROC) pos_msgs++;
+        }
+        usleep(FRAME_US);
+    }
+    long long ctxt = system_ctxt_switches() - ctxt0;
+    long long prod = group_ctxt_switches(creator) - prod0;
+    double secs = (double)(now_us() - t_meas) / 1e6;
+    kill(-creator, SIGKILL);
+    waitpid(creator, NULL, 0);
+    cleanup_pipes();
+
+    printf("  %-12s processi=%3lld  posizioni/s=%5.0f  cambi di contesto/s: sistema=%5.0f produttori=%5.0f"
+           "  produttori per posizione=%.2f\n",
+           lane_mode ? "corsie" : pool ? "pool" : "fork singola", (long long)atomic_load(&shared_stats->forks),
+           (double)pos_msgs / secs, (double)ctxt / secs, (double)prod / secs,
+           pos_msgs ? (double)prod / (double)pos_msgs : 0.0);
+}
+
+#define BENCH_REAP_SECS      10
+#define BENCH_REAP_CROCS     64
+#define BENCH_REAP_SPAWN_MS  5           // spawn a raffica: il fiume resta pieno di processi
+
+// Un giro: creatore a fork singola a spawn forzato, il padre gira col vero ciclo a eventi
+// (smistamento dei coccodrilli, raccolta dei figli, sweep) e conta le syscall di liveness
+static void bench_reap_run(int mode) {
+    reap_mode = mode;
+    stats_init();
+    reset_entity_tables();
+    child_events_open();
+    if (transport_open() == -1) { perror("transport"); exit(1); }
+    int fl = fcntl(pipe_fds[0], F_GETFL, 0);
+    fcntl(pipe_fds[0], F_SETFL, fl | O_NONBLOCK);
+    pid_t creator = fork();
+    if (creator == 0) {
+        setpgid(0, 0);
+        croc_creator(pipe_fds[1]);
+        _exit(0);
+    }
+    setpgid(creator, creator);
+    loop_open();
+
+    long long sys0 = stat_liveness_syscalls, frames = 0, despawns = 0, peak = 0;
+    long long t0 = now_us();
+    while (now_us() - t0 < BENCH_REAP_SECS * 1000000LL) {
+        loop_wait_frame();
+        begin_frame_lanes();
+        msg batch[MAX_MSGS_PER_FRAME];
+        int n = pending_n;
+        memcpy(batch, pending_msgs, (size_t)n * sizeof(msg));
+        pending_n = 0;
+        int got = transport_recv_batch(batch + n, MAX_MSGS_PER_FRAME - n);
+        if (got > 0) n += got;
+        for (int k = 0; k < n; k++) {
+            const msg *m = &batch[k];
+            if (m->id == OBJ_CROC) apply_croc_position(m);
+            else if (m->id == OBJ_CROC_SPAWN) apply_croc_spawn(m, now_us());
+            else if (m->id == OBJ_CROC_DESPAWN) { apply_croc_despawn(m); despawns++; }
+            else if (m->id == OBJ_FIRE) spawn_analytic_projectile(m->x, m->y, m->x_speed, OBJ_PROJECTILE, m->t_us);
+            else if (m->id == OBJ_PROJECTILE) apply_projectile_position(m);
+            else if (m->id == OBJ_PROJECTILE_GONE) release_exited_pid(m->pid);
+        }
+        reap_children();
+        advance_dead_reckoned_crocs(now_us());
+        advance_analytic_projectiles(now_us());
+        sweep_crocs_outside(1, GAME_WIDTH - 2);
+        sweep_projectiles_outside(1, GAME_WIDTH - 2);
+        if (croc_arena.live + projectile_arena.live > peak) peak = croc_arena.live + projectile_arena.live;
+        frames++;
+    }
+    long long sys = stat_liveness_syscalls - sys0;
+    kill(-creator, SIGKILL);
+    waitpid(creator, NULL, 0);
+    loop_close();
+    child_events_close();
+    cleanup_pipes();
+    printf("  %-9s frame=%lld  syscall di liveness=%lld (%.2f/frame)  picco entità=%lld  uscite annunciate=%lld"
+           "  fork=%lld\n", mode == REAP_POLL ? "polling" : "signalfd", frames, sys,
+           frames ? (double)sys / (double)frames : 0.0, peak, despawns, (long long)atomic_load(&shared_stats->forks));
+}
+
+#define BENCH_SIM_SEED       42
+#define BENCH_SIM_SECS       10          // confronto col creatore a processi (tempo reale)
+#define BENCH_SIM_SPAWN_MS   100
+#define BENCH_SIM_CROCS      16
+#define BENCH_SIM_TRACE      1024
+#define BENCH_SIM_DET_SECS   120         // secondi simulati per la verifica di determinismo
+#define BENCH_SIM_BIG_CROCS  12000       // mondo grande: oltre 10k entità vive
+#define BENCH_SIM_BIG_SECS   60          // secondi simulati del mondo grande
+
+// Sequenza di spawn del vero croc_creator (pool, dead reckoning): i flussi dei record di nascita
+static int bench_sim_process_trace(int *trace, long long *fires) {
+    stats_init();
+    if (transport_open() == -1) { perror("transport"); exit(1); }
+    int fl = fcntl(pipe_fds[0], F_GETFL, 0);
+    fcntl(pipe_fds[0], F_SETFL, fl | O_NONBLOCK);
+    pid_t creator = fork();
+    if (creator == 0) {
+        setpgid(0, 0);
+        croc_creator(pipe_fds[1]);
+        _exit(0);
+    }
+    setpgid(creator, creator);
+    int n = 0;
+    *fires = 0;
+    long long t0 = now_us();
+    while (now_us() - t0 < BENCH_SIM_SECS * 1000000LL) {
+        msg batch[MAX_MSGS_PER_FRAME];
+        int got = transport_recv_batch(batch, MAX_MSGS_PER_FRAME);
+        if (got < 0) break;
+        for (int k = 0; k < got; k++) {
+            if (batch[k].id == OBJ_CROC_SPAWN && n < BENCH_SIM_TRACE) {
+                trace[n++] = (Y_MARCIAPIEDE - batch[k].y) / FROG_H - 1; // inverso di flow_to_y
+            } else if (batch[k].id == OBJ_FIRE) {
+                (*fires)++;
+            }
+        }
+        usleep(FRAME_US);
+    }
+    kill(-creator, SIGKILL);
+    waitpid(creator, NULL, 0);
+    cleanup_pipes();
+    return n;
+}
+
+// Simulazione locale da t=0 a until_us, avanzata a frame di frame_us (irregolari se jitter)
+static uint64_t bench_sim_local_run(long long until_us, long long frame_us, bool jitter) {
+    reset_entity_tables();
+    sim_start(0);
+    Rng frames;
+    rng_seed(&frames, 7);
+    for (long long t = 0; t < until_us;) {
+        t += jitter ? 1000 + rng_next(&frames) % (3 * frame_us) : frame_us;
+        begin_frame_lanes();
+        sim_advance(t < until_us ? t : until_us);
+    }
+    return sim.digest;
+}
+
+static void bench_sim_print_hist(const char *label, const int *trace, int n) {
+    int hist[N_FLUSSI] = { 0 };
+    for (int k = 0; k < n; k++) {
+        if (trace[k] >= 0 && trace[k] < N_FLUSSI) hist[trace[k]]++;
+    }
+    printf("  %-8s partiti=%3d  per flusso:", label, n);
+    for (int f = 0; f < N_FLUSSI; f++) printf(" %3d", hist[f]);
+    printf("\n");
+}
 
+// Stesso seme nelle due modalità: sequenza di spawn, determinismo e mondo grande a passo fisso
+static void bench_sim(void) {
+    sim_seed = BENCH_SIM_SEED;
+    croc_protocol = CROC_PROTO_DR;
+    max_active_crocs = BENCH_SIM_CROCS;
+    spawn_interval_ms = BENCH_SIM_SPAWN_MS;
+    printf("sim: seme %d, %d coccodrilli al massimo, spawn ogni %d ms, %d s per modalità\n",
+           BENCH_SIM_SEED, BENCH_SIM_CROCS, BENCH_SIM_SPAWN_MS, BENCH_SIM_SECS);
+
+    static int proc_trace[BENCH_SIM_TRACE], local_trace[BENCH_SIM_TRACE];
+    long long proc_fires = 0;
+    int np = bench_sim_process_trace(proc_trace, &proc_fires);
+    sim.trace = local_trace;
+    sim.trace_cap = BENCH_SIM_TRACE;
+    bench_sim_local_run(BENCH_SIM_SECS * 1000000LL, FRAME_US, false);
+    int nl = sim.trace_n;
+    sim.trace = NULL;
+    int same = 0;
+    while (same < np && same < nl && proc_trace[same] == local_trace[same]) same++;
+    bench_sim_print_hist("processi", proc_trace, np);
+    bench_sim_print_hist("locale", local_trace, nl);
+    printf("  sequenze di flussi uguali per i primi %d spawn su %d/%d  spari: processi=%lld locale=%lld\n",
+           same, np, nl, proc_fires, sim.fired);
+
+    // Determinismo: frame regolari contro frame irregolari, stessa impronta dei record
+    spawn_interval_ms = 0;
+    croc_protocol = CROC_PROTO_POS;
+    uint64_t d1 = bench_sim_local_run(BENCH_SIM_DET_SECS * 1000000LL, FRAME_US, false);
+    uint64_t d2 = bench_sim_local_run(BENCH_SIM_DET_SECS * 1000000LL, FRAME_US, true);
+    sim_seed = BENCH_SIM_SEED + 1;
+    uint64_t d3 = bench_sim_local_run(BENCH_SIM_DET_SECS * 1000000LL, FRAME_US, false);
+    sim_seed = BENCH_SIM_SEED;
+    printf("  determinismo (%d s simulati): frame regolari=%016llx irregolari=%016llx %s, altro seme=%016llx\n",
+           BENCH_SIM_DET_SECS, (unsigned long long)d1, (unsigned long long)d2, d1 == d2 ? "uguali" : "DIVERSE",
+           (unsigned long long)d3);
+
+    // Mondo grande: ciclo completo del padre (meno il disegno) più veloce del tempo reale
+    max_active_crocs = BENCH_SIM_BIG_CROCS;
+    spawn_interval_ms = 1;
+    reset_entity_tables();
+    sim_start(0);
+    int peak_crocs = 0, peak_proj = 0, peak_live = 0;
+    long long frames = 0;
+    long long w0 = now_us();
+    for (long long t = FRAME_US; t <= BENCH_SIM_BIG_SECS * 1000000LL; t += FRAME_US) {
+        begin_frame_lanes();
+        sim_advance(t);
+        advance_dead_reckoned_crocs(t);
+        advance_analytic_projectiles(t);
+        sweep_projectiles_outside(1, GAME_WIDTH - 2);
+        sort_entity_lanes();
+        rebuild_collision_bitboards();
+        frames++;
+        if (croc_arena.live + projectile_arena.live > peak_live) peak_live = croc_arena.live + projectile_arena.live;
+        if (croc_arena.live > peak_crocs) peak_crocs = croc_arena.live;
+        if (projectile_arena.live > peak_proj) peak_proj = projectile_arena.live;
+    }
+    double wall = (double)(now_us() - w0) / 1e6;
+    printf("  mondo grande: %d s simulati in %.2f s (%.1fx il tempo reale), %.0f us/frame,"
+           " picco entità=%d (coccodrilli=%d proiettili=%d) partiti=%lld\n",
+           BENCH_SIM_BIG_SECS, wall, wall > 0 ? BENCH_SIM_BIG_SECS / wall : 0.0,
+           frames ? wall * 1e6 / (double)frames : 0.0, peak_live, peak_crocs, peak_proj, sim.spawned);
+}
 
+// Esegue il benchmark richiesto; restituisce il codice di uscita del programma
+static int run_bench(const char *name) {
+    if (strcmp(name, "transport") == 0) {
+        printf("transport: %d produttori x %d messaggi (%zu byte)\n",
+               BENCH_PRODUCERS, BENCH_MSGS_PER_PRODUCER, sizeof(msg));
+        bench_transport_run(TRANSPORT_PIPE);
+        bench_transport_run(TRANSPORT_SHM);
+        bench_transport_run(TRANSPORT_URING);
+        if (uring_fallback_errno) printf("uring  non disponibile (%s): misurata la pipe\n", strerror(uring_fallback_errno));
+        return 0;
+    }
+    if (strcmp(name, "croc-proto") == 0) {
+        if (spawn_interval_ms <= 0) spawn_interval_ms = BENCH_CROC_SPAWN_MS;
+        printf("croc-proto: %d s per protocollo, spawn ogni %d ms\n", BENCH_CROC_SECS, spawn_interval_ms);
+        bench_croc_proto_run(CROC_PROTO_POS);
+        bench_croc_proto_run(CROC_PROTO_DR);
+        return 0;
+    }
+    if (strcmp(name, "dispatch") == 0) {
+        bench_dispatch();
+        return 0;
+    }
+    if (strcmp(name, "collision") == 0) {
+        bench_collision();
+        return 0;
+    }
+    if (strcmp(name, "grenades") == 0) {
+        bench_grenades();
+        return 0;
+    }
+    if (strcmp(name, "tunnel") == 0) {
+        bench_tunnel();
+        return 0;
+    }
+    if (strcmp(name, "flow") == 0) {
+        max_active_crocs = BENCH_FLOW_CROCS;
+        spawn_interval_ms = BENCH_FLOW_SPAWN_MS;
+        printf("flow: %d coccodrilli, padre fermo %d ms poi drena %d ms\n",
+               BENCH_FLOW_CROCS, BENCH_FLOW_STALL_MS, BENCH_FLOW_DRAIN_MS);
+        bench_flow_run(0);
+        bench_flow_run(1);
+        return 0;
+    }
+    if (strcmp(name, "lanes") == 0) {
+        max_active_crocs = BENCH_LANES_CROCS;
+        spawn_interval_ms = BENCH_LANES_SPAWN_MS;
+        printf("lanes: %d coccodrilli al massimo, %d s (primi %d esclusi), cambi di contesto da /proc\n",
+               BENCH_LANES_CROCS, BENCH_LANES_SECS, BENCH_LANES_WARMUP);
+        bench_lanes_run(0, 0);
+        bench_lanes_run(0, 1);
+        bench_lanes_run(1, 0);
+        return 0;
+    }
+    if (strcmp(name, "sim") == 0) {
+        bench_sim();
+        return 0;
+    }
+    if (strcmp(name, "reap") == 0) {
+        max_active_crocs = BENCH_REAP_CROCS;
+        spawn_interval_ms = BENCH_REAP_SPAWN_MS;
+        croc_pool_enabled = 0;
+        printf("reap: %d s per modo, %d coccodrilli a fork singola al massimo, spawn ogni %d ms, proiettili %s\n",
+               BENCH_REAP_SECS, BENCH_REAP_CROCS, BENCH_REAP_SPAWN_MS, PROJECTILE_PROCESSES ? "a processi" : "del padre");
+        bench_reap_run(REAP_POLL);
+        bench_reap_run(REAP_SIGNALFD);
+        return 0;
+    }
+    if (strcmp(name, "coalesce") == 0) {
+        bench_coalesce();
+        return 0;
+    }
+    if (strcmp(name, "input") == 0) {
+        printf("input: %d s, %d produttori a raffica sul canale principale, un tasto ogni %d ms\n",
+               BENCH_INPUT_SECS, BENCH_INPUT_FLOODERS, BENCH_INPUT_KEY_MS);
+        bench_input_run(0);
+        bench_input_run(1);
+        return 0;
+    }
+    fprintf(stderr, "benchmark sconosciuto: %s\n", name);
+    return 2;
+}
@@ -16,6 +16,10 @@
 #include <pthread.h>
 #include <semaphore.h>
 #include <sys/types.h>
+#include <stdatomic.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 #define CURS 0 //visibilità cursore
 #define ND 1 //valore di nodelay
@@ -116,6 +120,10 @@
 #define PLANT_DISTANCE 70
 
 
+//capacità della coda dei messaggi (arrotondata a potenza di 2), modificabile con --coda=N.
+//DIM_BUFFER resta la capacità del vecchio buffer, usata come riferimento nel benchmark
+#define CAPACITA_CODA 256
+#define CODA_MAX (1 << 24) //capacità massima accettata da --coda=N
 #define DIM_BUFFER 20
 
 struct screen {
@@ -159,17 +167,6 @@ struct match_data {
    bool running;
 };
 
-struct croc_params {
-   int flusso;
-   bool evil;
-};
-
-struct bull_params {
-   int x;
-   int y;
-   int type;
-};
-
 struct screen sfrog;
 
 struct manchestr partita;
@@ -178,17 +175,104 @@ struct msg entity_data[9];
 
 struct entity game_matrix[DIM_X+2*CROC_X][DIM_Y];
 
-_Thread_local  evil_flag = 0;
-
-pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t mutex_refresh = PTHREAD_MUTEX_INITIALIZER;
 
-sem_t sem_liberi, sem_occupati;
-
 pthread_t fcroc_pid;
 pthread_t fplant_pid;
 
-int leggi = 0, scrivi = 0;
+//cella della coda: il numero di sequenza dice se è libera (== posizione) o pronta (== posizione+1)
+struct cella {
+   atomic_uint seq;
+   struct msg m;
+};
+
+//coda limitata lock-free, più produttori e un solo consumatore (il thread di gioco)
+//Unico meccanismo di risveglio (al posto di sem_liberi, sem_occupati e mutex): due parole futex,
+//toccate con una syscall solo se dall'altra parte qualcuno dorme davvero
+struct coda_msg {
+   struct cella* celle;
+   unsigned cap;
+   atomic_uint scrivi; //prossima posizione da prenotare (produttori, con CAS)
+   unsigned leggi; //prossima posizione da leggere (solo il consumatore)
+   atomic_int nuovi; //futex: cambia quando arriva un messaggio e il consumatore dorme
+   atomic_int consumatore_dorme;
+   atomic_int liberate; //futex: cambia quando si libera una cella e qualche produttore aspetta
+   atomic_int produttori_in_attesa;
+   atomic_long piena; //volte in cui un produttore ha trovato la coda piena
+};
+
+struct coda_msg coda;
+unsigned capacita_coda = CAPACITA_CODA;
+
+//--- entità come task a passi: ogni passo fa un "giro" del vecchio loop del thread e ritorna l'attesa
+//in us prima del prossimo. Con --thread=pool (default) i passi girano su un pool di worker, con
+//--thread=pthread ogni task ha il suo thread. In entrambi i casi il controllo è cooperativo: niente
+//segnali né pthread_cancel, i flag del task e l'epoca della manche si guardano tra un passo e l'altro
+#define N_WORKER 4 //modificabile con --pool=N
+#define MAX_TASK 1024 //task contemporanei; potenza di 2, è anche la capacità di ogni deque
+
+struct task {
+   pthread_t id; //identità dell'entità in msg.pid e game_matrix (generazione<<16 | slot+1), mai -1, -2 o 2
+   int tipo; //FROG_ID, CROC_ID, ...
+   long scadenza; //prossimo passo (us, CLOCK_MONOTONIC)
+   int epoca; //manche in cui è nato: se pool.epoca cambia il task è finito
+   atomic_bool cancellato; //kill_thread(): il task non farà più passi
+   atomic_bool colpito; //send_signal(): quello che prima faceva SIGUSR1
+   struct msg m; //stato dell'entità tra un passo e l'altro
+   int flusso, n_plant, old_flusso, old_flusso1;
+   int prossimo_libero;
+};
+
+//deque del worker: si inserisce sul fondo, il proprietario prende dalla testa (il più vecchio: i task
+//sono periodici e con il LIFO la rana, sempre pronta, affamerebbe i proiettili che crea) e i ladri dal fondo
+struct deque {
+   pthread_mutex_t lock;
+   struct task* t[MAX_TASK];
+   _Atomic unsigned testa, fondo; //scritti sotto lock, letti anche senza da deque_ruba
+};
+
+struct worker {
+   pthread_t tid;
+   int indice;
+   int epoca; //ultima epoca per cui ho fatto pulizia
+   struct deque dq;
+   struct task* timer[MAX_TASK]; //min-heap per scadenza dei task in attesa, lo tocca solo il worker
+   int n_timer;
+};
+
+struct pool_task {
+   struct worker* w;
+   int n;
+   struct task task[MAX_TASK];
+   pthread_mutex_t lock_slot; //protegge slot, lista libera e flag dei task
+   int libero;
+   atomic_int vivi; //futex: task allocati; a fine manche kill_all() aspetta che arrivi a 0
+   atomic_int epoca; //futex: manche corrente, ci dormono i thread per-entità tra un passo e l'altro
+   atomic_int lavoro; //futex: cambia quando c'è lavoro da rubare
+   atomic_int inattivi; //worker che dormono su lavoro
+   atomic_uint prossimo; //round robin per i task creati fuori dai worker
+};
+
+struct pool_task pool;
+bool modalita_pool = true;
+int n_worker = N_WORKER;
+_Thread_local struct worker* worker_corrente = NULL;
+_Thread_local struct task* task_corrente = NULL; //task di cui il worker sta eseguendo un passo
+
+//statistiche della partita (stampate a fine partita con --manche=N)
+#define FRAME_BUCKET_US 10
+#define N_BUCKET_FRAME 10000 //istogramma fino a 100 ms, oltre finisce nell'ultimo bucket
+atomic_long thread_creati;
+atomic_int thread_vivi;
+atomic_int picco_thread;
+atomic_long task_creati;
+atomic_int picco_task;
+long frame_hist[N_BUCKET_FRAME];
+long n_frame, frame_max;
+int max_manche = 0; //0 = si gioca per sempre
+//fine manche -> motore fermo: tempo di kill_all() ed entità rimaste vive dopo
+long n_fine_manche, quiete_tot_us, quiete_max_us;
+int rimasti_max;
 
 int flussi[N_FLUSSI];
 
@@ -202,7 +286,6 @@ char bull_sprite[CROC_Y*CROC_X][CROC_X] = {"▲","•"};
 
 //finestra di gioco
 WINDOW *gamewin;
-struct msg buffer[DIM_BUFFER];
 
 //prototipi func
 void game_init();
@@ -229,15 +312,6 @@ bool frog_in_water();
 void create_game_win();
 bool time_is_over(long int);
 bool manche_is_over(long int);
-void handle_signal_crocs(int);
-void handle_signal_plants(int);
-void* bullet(void*);
-void* frog();
-void* croc_creator();
-void* plant_creator();
-void* croc(void*);
-void* plant(void*);
-//void croc_creator(int);
 void generate_thread(int, int, int);
 void generate_frog();
 void generate_crocs();
@@ -259,6 +333,46 @@ void update_frog(int, int, pthread_t);
 void delete_old(struct msg, struct msg);
 void update(struct msg, struct msg);
 void receive_data();
+void init_coda(unsigned);
+void reset_coda();
+void send_msg(struct msg);
+struct msg receive_msg();
+void futex_wait(atomic_int*, int, long);
+void futex_wake(atomic_int*, int);
+long tempo_us();
+void init_task();
+void pool_init(int);
+void* worker_loop(void*);
+void* thread_entita(void*);
+struct task* crea_task(int, int, int);
+void accoda_task(struct task*);
+bool task_fermo(struct task*);
+void attendi_passo(struct task*, long);
+void pulisci_worker(struct worker*);
+void pool_cancella(pthread_t);
+void pool_segnala(pthread_t);
+void barriera_fine_manche();
+struct task* trova_task(pthread_t);
+void libera_task(struct task*);
+void esegui_task(struct worker*, struct task*);
+long passo_task(struct task*);
+long passo_frog(struct task*);
+long passo_croc(struct task*);
+long passo_plant(struct task*);
+long passo_bullet(struct task*);
+long passo_croc_creator(struct task*);
+long passo_plant_creator(struct task*);
+void deque_push(struct deque*, struct task*);
+struct task* deque_pop(struct deque*);
+struct task* deque_ruba(struct deque*);
+void timer_push(struct worker*, struct task*);
+struct task* timer_pop(struct worker*);
+void conta_thread(int);
+void registra_frame(long);
+long percentile_frame(double);
+void stampa_statistiche();
+int entita_vive();
+int bench_coda();
 void init_flux_speed();
 void init_pipe();
 void ready_frog();
@@ -269,12 +383,35 @@ void run_clean(struct manchestr, struct match_data*);
 void run(bool, bool, struct timespec, int, int);
 void game_polling();
 
-int main() {
+int main(int argc, char** argv) {
+   bool bench = false;
+   for (int i = 1; i < argc; i++) {
+      if (strncmp(argv[i], "--coda=", 7) == 0 && atol(argv[i] + 7) > 0 && atol(argv[i] + 7) <= CODA_MAX) {capacita_coda = atol(argv[i] + 7);}
+      else if (strcmp(argv[i], "--bench=coda") == 0) {bench = true;}
+      else if (strcmp(argv[i], "--thread=pool") == 0) {modalita_pool = true;}
+      else if (strcmp(argv[i], "--thread=pthread") == 0) {modalita_pool = false;}
+      else if (strncmp(argv[i], "--pool=", 7) == 0 && atoi(argv[i] + 7) > 0) {n_worker = atoi(argv[i] + 7);}
+      else if (strncmp(argv[i], "--manche=", 9) == 0) {max_manche = atoi(argv[i] + 9);}
+      else {
+         fprintf(stderr, "uso: %s [--coda=N] [--bench=coda] [--thread=pool|pthread] [--pool=N] [--manche=N]\n", argv[0]);
+         return 2;
+      }
+   }
+   init_coda(capacita_coda);
+   if (bench) {return bench_coda();}
+   //il thread principale è vivo ma non è stato creato da noi
+   atomic_store(&thread_vivi, 1);
+   atomic_store(&picco_thread, 1);
+   init_task();
+   if (modalita_pool) {pool_init(n_worker);}
    //funzione che si occupa di inizializzare la schermata e i colori
    game_init();
    //funzione che contiene la logica di gioco
    game_polling();
-
+   //si arriva qui solo con --manche=N
+   endwin();
+   stampa_statistiche();
+   return 0;
 }
 
 //inizializza schermo e colori
@@ -542,322 +679,21 @@ void generate_graphics(long int tempo_inizio, int vite, int punteggio) {
    draw_loop();
    }
  
-//funzione che gestisce il segnale mandato agli oggetti pianta (proiettile rana colpisce coccodrillo cattivo)  
-void handle_signal_plants(int signal) {
-    if (signal == SIGUSR1) {
-       srand(pthread_self());
-       usleep(rand() % ((PLANT_STOP_UPPER - PLANT_STOP_LOWER + 1) + PLANT_STOP_LOWER));  
-    }
-}
-   
-//funzione che gestisce il segnale mandato agli oggetti pianta  (proiettile rana colpisce pianta)
-void handle_signal_crocs(int signal) {
-    if (signal == SIGUSR1) {
-       evil_flag = 1;
-       beep();
-    }
-}
-   
-//funzione pianta
-
-void* plant(void* nn) {
-   struct msg m; int shoot;
-   int* par = (int*)nn;
-   int n = *par;
-   m.x_speed = 0;
-   m.y_speed = 0;
-   srand(pthread_self());
-   m.x = CROC_X+PLANT_PX+PLANT_DISTANCE*n;
-   m.y = FIRST_PLANT_PY;
-   m.pid = pthread_self();
-   m.id = PLANT_ID;
-   while(true) {
-      pthread_testcancel();
-      sem_wait(&sem_liberi);
-      buffer[scrivi] = m;
-      pthread_mutex_lock(&mutex);
-      scrivi = (scrivi + 1) % DIM_BUFFER;
-      pthread_mutex_unlock(&mutex);
-      sem_post(&sem_occupati);
-      //il segnale mi dice se la pianta è stata colpita da un proiettile rana
-      usleep(500);
-      signal(SIGUSR1, handle_signal_plants);
-      usleep(500); 
-      shoot = rand() % 5;
-      if (shoot == 3) {
-         generate_thread(BULL_PL_ID, -1, m.x);   
-      }
-      usleep(PLANT_DELAY);    
-      }  
-}
-
-//funzione coccodrillo
-void* croc(void* params) {
-   
-   struct msg m;
-   srand(time(NULL));
-   struct croc_params* par = (struct croc_params*)params;
-   int flusso = par->flusso;
-   bool evil = par -> evil;
-   evil_flag = 0;
-   m.x_speed = (flussi[flusso] < 0) ? (-1): (1);;
-   //if (flusso == 3) {beep(); }
-   m.y_speed = 0;
-   m.id = (evil) ? (EV_CROC_ID): (CROC_ID);
-   m.x = (m.x_speed < 0) ? (FIUMESX+FIUME_X+CROC_X): (0);
-   m.y = ((flusso)*FLUX_Y)+(TANEY+RIVA_Y+3);
-   m.pid = pthread_self();
-   while(true) {
-    pthread_testcancel();
-    if (evil_flag == 1) {m.id = CROC_ID;}
-    if (m.x > -1 || m.x < CROC_X+2*FROG_X+1){
-       if (m.id == EV_CROC_ID && (rand() % IMMERSION == 0)) {
-          m.id = IMM_CROC_ID;
-        }
-       sem_wait(&sem_liberi);
-       buffer[scrivi] = m;
-       pthread_mutex_lock(&mutex);
-       scrivi = (scrivi + 1) % DIM_BUFFER;
-       pthread_mutex_unlock(&mutex);
-       sem_post(&sem_occupati);
-      }
-    usleep(500);
-    signal(SIGUSR1, handle_signal_crocs);
-    usleep(500);
-    //velocità flusso
-    usleep(abs(flussi[flusso]));
-    m.x += m.x_speed;  
-   } 
-}
-
-
-
-//padre delle piante
-void* plant_creator() {
-     struct msg m;
-     m.id = FPLANT_ID;
-     m.pid = pthread_self();
-     sem_wait(&sem_liberi);
-     buffer[scrivi] = m;
-     pthread_mutex_lock(&mutex);
-     scrivi = (scrivi + 1) % DIM_BUFFER;
-     pthread_mutex_unlock(&mutex);
-     sem_post(&sem_occupati);
-     for (int i = 0; i < N_PIANTE; i++) {
-        generate_thread(PLANT_ID, -1, i);   
-        }
-        
-     while (true) {
-        pthread_testcancel();
-        usleep(1000);
-        }
-}
-
-
-//padre dei coccodrilli
-void* croc_creator() {
-   srand(time(NULL));
-   int flusso, old_flusso = N_FLUSSI+2, old_flusso1 = N_FLUSSI+3, pid_count = 0, id = CROC_ID;
-   struct msg m;
-   m.id = FCROC_ID;
-   m.pid = pthread_self();
-   sem_wait(&sem_liberi);
-   buffer[scrivi] = m;
-   pthread_mutex_lock(&mutex);
-   scrivi = (scrivi + 1) % DIM_BUFFER;
-   pthread_mutex_unlock(&mutex);
-   sem_post(&sem_occupati);
-   while(true) {
-      flusso = rand() % N_FLUSSI;
-      //mi assicuro il flusso sia libero
-      while (flusso == old_flusso || flusso == old_flusso1) {
-         flusso = rand() % (N_FLUSSI);
-      }
-      old_flusso = flusso;
-      old_flusso1 = old_flusso;
-      //generazione coccodrilli malvagi
-      if (rand() % EV_CROC_RATE == 0) {
-         id = EV_CROC_ID;
-      }
-      pthread_testcancel();
-      generate_thread(id, flusso, -1);
-      id = CROC_ID;
-      pid_count += 1;
-      //wait non bloccanti
-      for (int i = 0; i <= pid_count; i++) {
-         waitpid(-1, NULL, WNOHANG);
-         }
-      usleep(CROC_DELAY);  
-    }   
-}
-
-//funzione del proiettile
-void* bullet(void* params) {
-   struct msg m;
-   struct bull_params* par = (struct bull_params*)params;
-   int flag = par -> type;
-   int x = par -> x;
-   int y = par -> y;
-   m.x_speed = 0;
-   m.y_speed = BULLET_SPEED*flag;
-   m.id = (flag < 0) ? (BULL_ID) : (BULL_PL_ID);
-   m.x = x;
-   m.y = y;
-   m.pid = pthread_self();
-   while(true) {
-      pthread_testcancel();
-      if (m.y > 0 && m.y < DIM_Y-2) {
-         sem_wait(&sem_liberi);
-         buffer[scrivi] = m;
-         pthread_mutex_lock(&mutex);
-         scrivi = (scrivi + 1) % DIM_BUFFER;
-         pthread_mutex_unlock(&mutex);
-         sem_post(&sem_occupati);
-      }
-      usleep(BULL_SPEED_DELAY);
-      m.y += m.y_speed;  
-      m.x = x;
-      }
-}
-
-//funzione che controlla la rana
-void* frog() {
-    
-    struct msg m; struct screen sfrog1; int input; bool new_input = false; 
-    
-    m.id = FROG_ID;
-    sfrog1.x = FROG_STARTX;
-    sfrog1.y = FROG_STARTY;
-    m.pid = pthread_self();
-    m.x = 0;
-    m.y = 0;
-    while(true) {
-       
-       pthread_mutex_lock(&mutex_refresh);
-       input = (int)getch();
-       pthread_mutex_unlock(&mutex_refresh);
-       
-       //Controllo se c'è dell'input nello stream
-       if (input != ERR) {new_input = true; } 
-       else {input = false; new_input = false;}
-       
-        switch (input) {
-        
-            case KEY_UP:
-                m.x = 0;
-                m.y = -FROG_Y; // Moving up
-                sfrog1.x += m.x;
-                sfrog1.y += m.y;
-                break;
-                
-            case KEY_DOWN:
-                m.x = 0;
-                m.y = FROG_Y; // Moving down
-                sfrog1.x += m.x;
-                sfrog1.y += m.y;
-                break;
-                
-            case KEY_LEFT:
-                m.x = -FROG_X;
-                m.y = 0; // Moving left
-                sfrog1.x += m.x;
-                sfrog1.y += m.y;
-                break;
-                
-            case KEY_RIGHT:
-                m.x = FROG_X;
-                m.y = 0; // Moving right
-                sfrog1.x += m.x;
-                sfrog1.y += m.y;
-                break;
-                
-            case TAB:
-               generate_thread(BULL_ID, -1, -1);
-               break;
-               
-            default:
-               break;
-        }
-        pthread_testcancel();
-        if ((new_input) && input != TAB && (m.x != 0 || m.y != 0)) {
-           sem_wait(&sem_liberi);
-           buffer[scrivi] = m;
-           pthread_mutex_lock(&mutex);
-           scrivi = (scrivi + 1) % DIM_BUFFER;
-           pthread_mutex_unlock(&mutex);
-           sem_post(&sem_occupati);
-           m.x = 0; m.y = 0;
-        }
-        
-        else {
-           m.x = 0; m.y = 0; 
-           sem_wait(&sem_liberi);
-           buffer[scrivi] = m;
-           pthread_mutex_lock(&mutex);
-           scrivi = (scrivi + 1) % DIM_BUFFER;
-           pthread_mutex_unlock(&mutex);
-           sem_post(&sem_occupati); 
-           }   
-      usleep(2000);
-    }
-}
-
-//template per generare threadi
+//template per generare threadi: l'entità diventa un task; con il pool costa una push sul deque,
+//altrimenti le si dà un thread tutto suo (staccato: finisce da solo quando vede il suo flag o l'epoca)
 void generate_thread(int id, int flusso, int n_plant) {
-   pthread_t tid; struct croc_params cparams; struct bull_params bparams;
-  
-      switch(id) {
-      
-         case FROG_ID:
-            pthread_create(&tid, NULL, &frog, NULL);
-            break;
-            
-         case FCROC_ID:
-            pthread_create(&tid, NULL, &croc_creator, NULL);
-            break;
-            
-         case FPLANT_ID:
-            pthread_create(&tid, NULL, &plant_creator, NULL);
-            break;
-            
-         case CROC_ID:
-            cparams.flusso = flusso;
-            cparams.evil = false;
-            pthread_create(&tid, NULL, &croc, &cparams);
-            usleep(1000);
-            break;
-         
-         case EV_CROC_ID:
-           cparams.flusso = flusso;
-           cparams.evil = true;
-           pthread_create(&tid, NULL, &croc, (void*)&cparams);
-           usleep(1000);
-           break;
-            
-         case PLANT_ID:
-            pthread_create(&tid, NULL, &plant, &n_plant);
-            usleep(1000);
-            break;
-            
-         case BULL_ID:
-            bparams.x = sfrog.x+1;
-            bparams.y = sfrog.y - BULL_Y;
-            bparams.type = -1;
-            pthread_create(&tid, NULL, &bullet, &bparams);
-            usleep(1000);
-            break;
-            
-         case BULL_PL_ID:
-            bparams.x = n_plant;
-            bparams.y = FIRST_PLANT_PY+PLANT_Y;
-            bparams.type = 1;
-            pthread_create(&tid, NULL, &bullet, &bparams);
-            usleep(1000);
-            break;
-            
-         default:
-            break;
-      }
+   pthread_t tid; struct task* t = crea_task(id, flusso, n_plant);
+   if (t == NULL) {return;}
+   if (modalita_pool) {
+      accoda_task(t);
+   }
+   else if (pthread_create(&tid, NULL, &thread_entita, t) == 0) {
+      pthread_detach(tid);
+      conta_thread(1);
+   }
+   else {
+      libera_task(t);
+   }
 }
 
 //genera il thread rana
@@ -882,32 +718,14 @@ void generate_threades() {
    generate_plants();
 }
 
-//Uccide ogni thread presente in gioco (tranne se stesso)
+//Ferma tutte le entità a fine manche: una barriera sola invece di un cancel per ogni pid trovato in game_matrix
 void kill_all() {
-   pthread_t arr[500] = {0}; int count = 0; bool not_killed = true;
-   for (size_t i = 0; i < CROC_X*2 + DIM_X; i++) {
-      for (size_t j = 0; j < DIM_Y; j++) {
-         for (size_t z = 0; z < 500; z++) {
-         if (pthread_equal(arr[z], game_matrix[i][j].pid)) {not_killed = false;}
-         }
-         if (not_killed) {
-            kill_thread(game_matrix[i][j].pid);
-            usleep(2000);
-            arr[count] = game_matrix[i][j].pid;
-            count += 1;
-            not_killed = true;
-            }
-      }
-   }
-   kill_thread(fcroc_pid);
-   kill_thread(fplant_pid);
+   barriera_fine_manche();
 }
-//Mando un segnale: lo uso per avvisare le piante di non mandare messaggi per un certo intervallo di tempo
+
+//Avvisa l'entità che è stata colpita (piante: si fermano un po', coccodrilli cattivi: diventano buoni)
 void send_signal(pthread_t tid) {
-   if (tid > 0) {
-      pthread_kill(tid, SIGUSR1);
-      usleep(500);
-   }
+   pool_segnala(tid);
 }
 
 
@@ -918,15 +736,9 @@ void pause_thread(pid_t pid) {
    waitpid(pid, NULL, WUNTRACED);  
 }
 
-//Uccide il thread
+//Uccide l'entità: al prossimo confine di passo smette (id non validi come -1, -2 o 2 vengono ignorati)
 void kill_thread(pthread_t tid)  {
-   if (!(pthread_equal(tid, -1) || pthread_equal(tid, -2))) {
-      
-      pthread_cancel(tid);
-      usleep(200);
-      pthread_join(tid, NULL);
-      usleep(500);
-   }
+   pool_cancella(tid);
 }
 
 //Funzione che ritorna il le coordinate della pianta più vicina
@@ -944,7 +756,8 @@ int which_plant(int x) {
 
 //controlla le collisioni prioettile-proiettile, proiettile-rana, proiettile-pianta e proiettile-coccodrillo
 bool check_bull_collisions(pthread_t pid, int x, int y, int speed) {
-   bool flag = false; struct msg m;
+   //velocità a zero: delete_old() deve cancellare proprio le posizioni passate, non quelle precedenti
+   bool flag = false; struct msg m = {0};
    if (speed > 0) {
       if (game_matrix[x][y+BULL_Y-1].id == BULL_ID) {
          kill_thread(pid);
@@ -1131,7 +944,7 @@ void delete_old(struct msg e, struct msg m) {
       game_matrix[old_x][m.y].first = false;
       for (size_t i = old_y; i < old_y+CROC_Y; i++)
     {
-      for(size_t j = CROC_X+m.x; (j <CROC_X+old_x); j++) {
+      for(size_t j = CROC_X+m.x; (j <CROC_X+old_x) && (j < DIM_X + 2*CROC_X); j++) {
       if (m.id == IMM_CROC_ID && game_matrix[j][i].id == FROG_ID) {sfrog.on_croc = false;}
       if (game_matrix[j][i].id == CROC_ID || game_matrix[j][i].id == EV_CROC_ID) {
          game_matrix[j][i].pid = -1;
@@ -1210,7 +1023,7 @@ void update(struct msg e, struct msg m){
    }
    }
    if ((m.id == CROC_ID || m.id == EV_CROC_ID) && m.x_speed > 0 && m.x <= (DIM_X + 2*CROC_X)) {
-      game_matrix[m.x][m.y].first = true;
+      if (m.x < DIM_X + 2*CROC_X) {game_matrix[m.x][m.y].first = true;}
       //if (m.id == EV_CROC_ID) {beep();}
       //((j < m.x+e.x) && (j < (DIM_X)))
       for (size_t i = m.y; i < m.y+CROC_Y; i++) {
@@ -1246,16 +1059,102 @@ void update(struct msg e, struct msg m){
    
 }
 
+//alloca la coda con la capacità richiesta (arrotondata alla potenza di 2 successiva)
+void init_coda(unsigned cap) {
+   unsigned c = 2;
+   while (c < cap && c < CODA_MAX) {c <<= 1;}
+   coda.cap = c;
+   coda.celle = malloc(sizeof(struct cella) * c);
+   if (coda.celle == NULL) {perror("malloc"); exit(1);}
+   reset_coda();
+}
+
+//svuota la coda (a inizio manche, con i produttori fermi)
+void reset_coda() {
+   for (unsigned i = 0; i < coda.cap; i++) {
+      atomic_store(&coda.celle[i].seq, i);
+   }
+   atomic_store(&coda.scrivi, 0);
+   coda.leggi = 0;
+   atomic_store(&coda.consumatore_dorme, 0);
+   atomic_store(&coda.produttori_in_attesa, 0);
+}
+
+//dorme finché *addr vale val, al massimo timeout_ns (0 = senza limite)
+void futex_wait(atomic_int* addr, int val, long timeout_ns) {
+   struct timespec ts = {timeout_ns / 1000000000L, timeout_ns % 1000000000L};
+   syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, timeout_ns > 0 ? &ts : NULL, NULL, 0);
+}
+
+//sveglia fino a n thread che dormono su addr
+void futex_wake(atomic_int* addr, int n) {
+   syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+//invia un messaggio al thread di gioco: prenota una cella con una CAS, la scrive e la pubblica.
+//A coda piena dorme finché il consumatore non libera una cella; l'attesa è a tempo perché un task
+//fermato nel frattempo (kill_thread() o fine manche) deve accorgersene e lasciar perdere il messaggio
+void send_msg(struct msg m) {
+   unsigned pos = atomic_load_explicit(&coda.scrivi, memory_order_relaxed);
+   while (true) {
+      struct cella* c = &coda.celle[pos & (coda.cap - 1)];
+      int diff = (int)(atomic_load_explicit(&c->seq, memory_order_acquire) - pos);
+      if (diff == 0) {
+         if (atomic_compare_exchange_weak_explicit(&coda.scrivi, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+            c->m = m;
+            atomic_store_explicit(&c->seq, pos + 1, memory_order_seq_cst);
+            if (atomic_load_explicit(&coda.consumatore_dorme, memory_order_seq_cst)) {
+               atomic_fetch_add(&coda.nuovi, 1);
+               futex_wake(&coda.nuovi, 1);
+            }
+            return;
+         }
+         //CAS fallita: pos è già stato aggiornato, riprovo
+      }
+      else if (diff < 0) {
+         atomic_fetch_add_explicit(&coda.piena, 1, memory_order_relaxed);
+         int visto = atomic_load(&coda.liberate);
+         atomic_fetch_add(&coda.produttori_in_attesa, 1);
+         //ricontrollo dopo essermi annunciato: se la cella si è liberata nel frattempo non dormo
+         if ((int)(atomic_load(&c->seq) - pos) < 0) {futex_wait(&coda.liberate, visto, 10000000L);}
+         atomic_fetch_sub(&coda.produttori_in_attesa, 1);
+         if (task_corrente != NULL && task_fermo(task_corrente)) {return;}
+         pos = atomic_load_explicit(&coda.scrivi, memory_order_relaxed);
+      }
+      else {
+         pos = atomic_load_explicit(&coda.scrivi, memory_order_relaxed);
+      }
+   }
+}
+
+//riceve il prossimo messaggio (blocca finché non ce n'è uno)
+struct msg receive_msg() {
+   struct msg m;
+   struct cella* c = &coda.celle[coda.leggi & (coda.cap - 1)];
+   while (atomic_load_explicit(&c->seq, memory_order_acquire) != coda.leggi + 1) {
+      //niente di pronto: mi annuncio, ricontrollo e dormo finché un produttore non pubblica
+      int visto = atomic_load(&coda.nuovi);
+      atomic_store_explicit(&coda.consumatore_dorme, 1, memory_order_seq_cst);
+      if (atomic_load_explicit(&c->seq, memory_order_seq_cst) != coda.leggi + 1) {futex_wait(&coda.nuovi, visto, 0);}
+      atomic_store(&coda.consumatore_dorme, 0);
+   }
+   m = c->m;
+   atomic_store_explicit(&c->seq, coda.leggi + coda.cap, memory_order_seq_cst);
+   coda.leggi++;
+   //i produttori fermi su coda piena li sveglio a blocchi, ogni mezza coda svuotata, invece che a
+   //ogni cella: con tanti produttori su pochi core evita un cambio di contesto per messaggio
+   if ((coda.leggi & (coda.cap / 2 - 1)) == 0 && atomic_load_explicit(&coda.produttori_in_attesa, memory_order_seq_cst)) {
+      atomic_fetch_add(&coda.liberate, 1);
+      futex_wake(&coda.liberate, coda.cap / 2); //tanti quante le celle libere
+   }
+   return m;
+}
+
 //funzione per gestire i messaggi dalle pipe
 void receive_data() {
    struct msg temp;
-   //aspetto ci sia qualcosa da leggere 
-   sem_wait(&sem_occupati);
-   //ricevo i dati sulle mie entità dal buffer
-   temp = buffer[leggi];
-   leggi = (leggi + 1) % DIM_BUFFER;
-   //incremento il contatore
-   sem_post(&sem_liberi);
+   //aspetto ci sia qualcosa da leggere e ricevo i dati sulle mie entità dalla coda
+   temp = receive_msg();
    if (temp.id == CROC_ID || temp.id == EV_CROC_ID || temp.id == FROG_ID || temp.id == BULL_ID || temp.id == PLANT_ID || temp.id == BULL_PL_ID) {
       //controlla se gli oggetti sono nei limiti dell'array
       if (is_out_of_bounds(temp)) {
@@ -1278,9 +1177,12 @@ void receive_data() {
       if (is_out_of_bounds(temp)) {
          kill_thread(temp.pid);
       }
-      temp.id = IMM_CROC_ID;
-      //cancella senza disegnare (animazione di scomparsa del coccodrillo);
-      delete_old(entity_data[CROC_ID], temp);
+      else {
+         temp.id = IMM_CROC_ID;
+         //cancella senza disegnare (animazione di scomparsa del coccodrillo);
+         //fuori dai limiti non si cancella: old_x cadrebbe oltre la fine di game_matrix
+         delete_old(entity_data[CROC_ID], temp);
+      }
    } 
 }
 
@@ -1295,17 +1197,9 @@ void init_fluxes() {
    }
 }
 
-//Inizializzo i semafori
+//Inizializzo la coda dei messaggi (al posto dei vecchi semafori)
 void init_sem() {
-   sem_init(&sem_occupati, 0, 0);
-   sem_init(&sem_liberi, 0, DIM_BUFFER);
-   leggi = 0; scrivi = 0;
-}
-
-//distruggo i semafori
-void destroy_sems() {
-   sem_destroy(&sem_occupati);
-   sem_destroy(&sem_liberi);
+   reset_coda();
 }
 
 //setto la posizione iniziale della rana
@@ -1366,9 +1260,14 @@ void clean_run(struct manchestr partita, struct match_data* dati_finali) {
 //funzione che contiene il loop della manche
 struct manchestr game(bool manche, long int startingtime, int vite, int score) {
 
+   long inizio_frame = tempo_us(), ora;
    partita.loss = false;
    partita.manche = manche;
    while(partita.manche) {
+      //durata del frame precedente, per le statistiche
+      ora = tempo_us();
+      registra_frame(ora - inizio_frame);
+      inizio_frame = ora;
       //controllo dimensioni schermo
       screen_size_loop();
       //Ricevo i dati e li gestico (collisioni ecc...)
@@ -1391,7 +1290,14 @@ struct manchestr game(bool manche, long int startingtime, int vite, int score) {
       usleep(3000);
    }
    
+   //misuro quanto ci mette il motore a fermarsi
+   inizio_frame = tempo_us();
    kill_all();
+   ora = tempo_us() - inizio_frame;
+   n_fine_manche++;
+   quiete_tot_us += ora;
+   if (ora > quiete_max_us) {quiete_max_us = ora;}
+   if (entita_vive() > rimasti_max) {rimasti_max = entita_vive();}
    //ritorna true se la manche è stata persa
    return partita;
 }
@@ -1399,9 +1305,9 @@ struct manchestr game(bool manche, long int startingtime, int vite, int score) {
 //funzione loop di gioco
 void run(bool running, bool manche, struct timespec start, int vite, int score) {
    
-   struct manchestr partita; struct match_data game_data;
+   struct manchestr partita; struct match_data game_data; int manche_giocate = 0;
    game_data.running = true; game_data.vite = VITE;
-   while(game_data.running) {
+   while(game_data.running && (max_manche == 0 || manche_giocate < max_manche)) {
       //controllo la size dello shermo
       screen_size_loop();
       //ogni ciclo resetto le condizioni del loop
@@ -1423,11 +1329,470 @@ void run(bool running, bool manche, struct timespec start, int vite, int score)
       partita = game(manche, start.tv_sec, vite, score); 
       //aggiorno i dati della run
       clean_run(partita, &game_data);
-      //distruggo i semafori
-      destroy_sems();
+      manche_giocate++;
       }
 }
  
+//--- pool di worker ---
+
+//tempo monotono in us
+long tempo_us() {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+//aggiorna il numero di thread vivi e il picco
+void conta_thread(int delta) {
+   if (delta > 0) {atomic_fetch_add(&thread_creati, delta);}
+   int vivi = atomic_fetch_add(&thread_vivi, delta) + delta;
+   int picco = atomic_load(&picco_thread);
+   while (vivi > picco && !atomic_compare_exchange_weak(&picco_thread, &picco, vivi)) {}
+}
+
+//prepara la tabella dei task (serve in tutte e due le modalità)
+void init_task() {
+   pthread_mutex_init(&pool.lock_slot, NULL);
+   for (int i = 0; i < MAX_TASK; i++) {
+      pool.task[i].id = 0;
+      pool.task[i].prossimo_libero = (i + 1 < MAX_TASK) ? (i + 1) : (-1);
+   }
+   pool.libero = 0;
+}
+
+//crea i worker una volta sola: da qui in poi nessuna pthread_create per le entità
+void pool_init(int n) {
+   pool.n = n;
+   pool.w = calloc(n, sizeof(struct worker));
+   for (int i = 0; i < n; i++) {
+      pool.w[i].indice = i;
+      pthread_mutex_init(&pool.w[i].dq.lock, NULL);
+      pthread_create(&pool.w[i].tid, NULL, &worker_loop, &pool.w[i]);
+      conta_thread(1);
+   }
+}
+
+//push sul fondo del deque
+void deque_push(struct deque* d, struct task* t) {
+   pthread_mutex_lock(&d->lock);
+   unsigned fondo = atomic_load_explicit(&d->fondo, memory_order_relaxed);
+   d->t[fondo & (MAX_TASK - 1)] = t;
+   atomic_store_explicit(&d->fondo, fondo + 1, memory_order_relaxed);
+   pthread_mutex_unlock(&d->lock);
+}
+
+//il proprietario prende dalla testa (il pronto da più tempo)
+struct task* deque_pop(struct deque* d) {
+   struct task* t = NULL;
+   pthread_mutex_lock(&d->lock);
+   unsigned testa = atomic_load_explicit(&d->testa, memory_order_relaxed);
+   if (atomic_load_explicit(&d->fondo, memory_order_relaxed) != testa) {
+      t = d->t[testa & (MAX_TASK - 1)];
+      atomic_store_explicit(&d->testa, testa + 1, memory_order_relaxed);
+   }
+   pthread_mutex_unlock(&d->lock);
+   return t;
+}
+
+//un altro worker ruba dal fondo (quello a cui il proprietario arriverebbe per ultimo)
+struct task* deque_ruba(struct deque* d) {
+   struct task* t = NULL;
+   //controllo senza lock per non prenderlo su un deque vuoto: può sbagliare, ma lo ripete sotto lock
+   if (atomic_load_explicit(&d->fondo, memory_order_relaxed) == atomic_load_explicit(&d->testa, memory_order_relaxed)) {return NULL;}
+   pthread_mutex_lock(&d->lock);
+   unsigned fondo = atomic_load_explicit(&d->fondo, memory_order_relaxed);
+   if (fondo != atomic_load_explicit(&d->testa, memory_order_relaxed)) {
+      t = d->t[--fondo & (MAX_TASK - 1)];
+      atomic_store_explicit(&d->fondo, fondo, memory_order_relaxed);
+   }
+   pthread_mutex_unlock(&d->lock);
+   return t;
+}
+
+//inserisce nel min-heap dei timer del worker
+void timer_push(struct worker* w, struct task* t) {
+   int i = w->n_timer++;
+   while (i > 0 && w->timer[(i - 1) / 2]->scadenza > t->scadenza) {
+      w->timer[i] = w->timer[(i - 1) / 2];
+      i = (i - 1) / 2;
+   }
+   w->timer[i] = t;
+}
+
+//toglie il task con la scadenza più vicina
+struct task* timer_pop(struct worker* w) {
+   struct task* primo = w->timer[0]; struct task* ultimo = w->timer[--w->n_timer];
+   int i = 0, figlio;
+   while ((figlio = 2 * i + 1) < w->n_timer) {
+      if (figlio + 1 < w->n_timer && w->timer[figlio + 1]->scadenza < w->timer[figlio]->scadenza) {figlio++;}
+      if (w->timer[figlio]->scadenza >= ultimo->scadenza) {break;}
+      w->timer[i] = w->timer[figlio];
+      i = figlio;
+   }
+   if (w->n_timer > 0) {w->timer[i] = ultimo;}
+   return primo;
+}
+
+//loop del worker: task scaduti nel deque, poi il deque, poi furto, altrimenti dorme fino al prossimo timer
+void* worker_loop(void* arg) {
+   struct worker* w = (struct worker*)arg; struct task* t; long ora, attesa; int pronti, visto;
+   worker_corrente = w;
+   while (true) {
+      //manche finita: libero subito i task vecchi che ho in mano, senza aspettare le loro scadenze
+      if (w->epoca != atomic_load(&pool.epoca)) {pulisci_worker(w);}
+      ora = tempo_us();
+      pronti = 0;
+      while (w->n_timer > 0 && w->timer[0]->scadenza <= ora) {
+         deque_push(&w->dq, timer_pop(w));
+         pronti++;
+      }
+      //più di un task pronto: se qualcuno dorme, che venga a rubare
+      if (pronti > 1 && atomic_load(&pool.inattivi) > 0) {
+         atomic_fetch_add(&pool.lavoro, 1);
+         futex_wake(&pool.lavoro, pronti - 1);
+      }
+      t = deque_pop(&w->dq);
+      for (int i = 1; t == NULL && i < pool.n; i++) {
+         t = deque_ruba(&pool.w[(w->indice + i) % pool.n].dq);
+      }
+      if (t != NULL) {
+         esegui_task(w, t);
+         continue;
+      }
+      //niente da fare: dormo fino al mio prossimo timer (o finché qualcuno non segnala lavoro)
+      visto = atomic_load(&pool.lavoro);
+      atomic_fetch_add(&pool.inattivi, 1);
+      attesa = (w->n_timer > 0) ? (w->timer[0]->scadenza - tempo_us()) : (100000);
+      if (attesa > 0) {futex_wait(&pool.lavoro, visto, attesa * 1000);}
+      atomic_fetch_sub(&pool.inattivi, 1);
+   }
+   return NULL;
+}
+
+//toglie dal timer e dal deque del worker i task fermati (epoca vecchia o cancellati) e li libera
+void pulisci_worker(struct worker* w) {
+   struct task* tenuti[MAX_TASK]; int n = 0; unsigned fondo;
+   w->epoca = atomic_load(&pool.epoca);
+   while (w->n_timer > 0) {
+      struct task* t = timer_pop(w);
+      if (task_fermo(t)) {libera_task(t);}
+      else {tenuti[n++] = t;}
+   }
+   for (int i = 0; i < n; i++) {timer_push(w, tenuti[i]);}
+   pthread_mutex_lock(&w->dq.lock);
+   unsigned testa = atomic_load_explicit(&w->dq.testa, memory_order_relaxed);
+   unsigned fine = atomic_load_explicit(&w->dq.fondo, memory_order_relaxed);
+   fondo = testa;
+   for (unsigned i = testa; i != fine; i++) {
+      struct task* t = w->dq.t[i & (MAX_TASK - 1)];
+      if (task_fermo(t)) {libera_task(t);}
+      else {w->dq.t[fondo++ & (MAX_TASK - 1)] = t;}
+   }
+   atomic_store_explicit(&w->dq.fondo, fondo, memory_order_relaxed);
+   pthread_mutex_unlock(&w->dq.lock);
+}
+
+//esegue un passo del task e lo rimette nel timer del worker (o lo libera se ha finito)
+void esegui_task(struct worker* w, struct task* t) {
+   long attesa = -1;
+   if (!task_fermo(t)) {
+      task_corrente = t;
+      attesa = passo_task(t);
+      task_corrente = NULL;
+   }
+   if (attesa < 0) {
+      libera_task(t);
+      return;
+   }
+   t->scadenza += attesa;
+   timer_push(w, t);
+}
+
+//crea il task di un'entità (stessi parametri di generate_thread); NULL se non ci sono slot liberi
+struct task* crea_task(int id, int flusso, int n_plant) {
+   struct task* t; int slot, vivi;
+   pthread_mutex_lock(&pool.lock_slot);
+   if (pool.libero < 0) {
+      pthread_mutex_unlock(&pool.lock_slot);
+      return NULL;
+   }
+   slot = pool.libero;
+   t = &pool.task[slot];
+   pool.libero = t->prossimo_libero;
+   //la generazione cambia a ogni riuso dello slot: un id vecchio non tocca mai il task nuovo
+   t->id = ((((t->id >> 16) % 0xffff) + 1) << 16) | (slot + 1);
+   atomic_store(&t->cancellato, false);
+   atomic_store(&t->colpito, false);
+   //un'entità creata da un'altra eredita la sua manche: se quella è già finita nasce già ferma
+   t->epoca = (task_corrente != NULL) ? (task_corrente->epoca) : (atomic_load(&pool.epoca));
+   vivi = atomic_fetch_add(&pool.vivi, 1) + 1;
+   pthread_mutex_unlock(&pool.lock_slot);
+   atomic_fetch_add(&task_creati, 1);
+   int picco = atomic_load(&picco_task);
+   while (vivi > picco && !atomic_compare_exchange_weak(&picco_task, &picco, vivi)) {}
+
+   t->tipo = id;
+   t->flusso = flusso;
+   t->n_plant = n_plant;
+   t->old_flusso = N_FLUSSI+2;
+   t->old_flusso1 = N_FLUSSI+3;
+   t->m.id = id;
+   t->m.pid = t->id;
+   t->m.x = 0;
+   t->m.y = 0;
+   t->m.x_speed = 0;
+   t->m.y_speed = 0;
+   switch (id) {
+      case CROC_ID:
+      case EV_CROC_ID:
+         t->m.x_speed = (flussi[flusso] < 0) ? (-1): (1);
+         t->m.x = (t->m.x_speed < 0) ? (FIUMESX+FIUME_X+CROC_X): (0);
+         t->m.y = ((flusso)*FLUX_Y)+(TANEY+RIVA_Y+3);
+         break;
+      case PLANT_ID:
+         t->m.x = CROC_X+PLANT_PX+PLANT_DISTANCE*n_plant;
+         t->m.y = FIRST_PLANT_PY;
+         break;
+      case BULL_ID:
+         t->m.x = sfrog.x+1;
+         t->m.y = sfrog.y - BULL_Y;
+         t->m.y_speed = -BULLET_SPEED;
+         break;
+      case BULL_PL_ID:
+         t->m.x = n_plant;
+         t->m.y = FIRST_PLANT_PY+PLANT_Y;
+         t->m.y_speed = BULLET_SPEED;
+         break;
+      default:
+         break;
+   }
+   t->scadenza = tempo_us();
+   return t;
+}
+
+//mette il task pronto nel pool: chi lo crea da dentro un worker se lo tiene (lo rubano gli altri
+//se serve), il resto va a turno
+void accoda_task(struct task* t) {
+   if (worker_corrente != NULL) {
+      deque_push(&worker_corrente->dq, t);
+   }
+   else {
+      deque_push(&pool.w[atomic_fetch_add(&pool.prossimo, 1) % pool.n].dq, t);
+   }
+   if (atomic_load(&pool.inattivi) > 0) {
+      atomic_fetch_add(&pool.lavoro, 1);
+      futex_wake(&pool.lavoro, 1);
+   }
+}
+
+//ritorna il task vivo con quell'id (chiamare con lock_slot preso)
+struct task* trova_task(pthread_t id) {
+   unsigned long slot = (id & 0xffff) - 1;
+   if (slot >= MAX_TASK || pool.task[slot].id != id) {return NULL;}
+   return &pool.task[slot];
+}
+
+//rimette lo slot nella lista libera (l'ultimo a uscire sveglia la barriera di fine manche)
+void libera_task(struct task* t) {
+   pthread_mutex_lock(&pool.lock_slot);
+   t->prossimo_libero = pool.libero;
+   pool.libero = t - pool.task;
+   t->id &= ~0xffffUL; //tengo la generazione, l'id non è più valido
+   pthread_mutex_unlock(&pool.lock_slot);
+   if (atomic_fetch_sub(&pool.vivi, 1) == 1) {futex_wake(&pool.vivi, 1);}
+}
+
+//il task non deve fare altri passi: cancellato da solo o finita la sua manche
+bool task_fermo(struct task* t) {
+   return atomic_load(&t->cancellato) || t->epoca != atomic_load(&pool.epoca);
+}
+
+//--thread=pthread: un thread per entità che fa i passi del task uno dopo l'altro
+void* thread_entita(void* arg) {
+   struct task* t = (struct task*)arg; long attesa;
+   task_corrente = t;
+   while (!task_fermo(t) && (attesa = passo_task(t)) >= 0) {
+      attendi_passo(t, attesa);
+   }
+   libera_task(t);
+   conta_thread(-1);
+   return NULL;
+}
+
+//dorme tra un passo e l'altro sulla parola dell'epoca: la fine manche sveglia tutti con un solo futex_wake
+void attendi_passo(struct task* t, long attesa) {
+   long fine = tempo_us() + attesa, resto;
+   while (!task_fermo(t) && (resto = fine - tempo_us()) > 0) {
+      futex_wait(&pool.epoca, t->epoca, resto * 1000);
+   }
+}
+
+//kill_thread() per i task: il passo in corso finisce, poi il task non viene più eseguito
+void pool_cancella(pthread_t id) {
+   struct task* t;
+   pthread_mutex_lock(&pool.lock_slot);
+   if ((t = trova_task(id)) != NULL) {atomic_store(&t->cancellato, true);}
+   pthread_mutex_unlock(&pool.lock_slot);
+}
+
+//send_signal() per i task: il prossimo passo vede il flag
+void pool_segnala(pthread_t id) {
+   struct task* t;
+   pthread_mutex_lock(&pool.lock_slot);
+   if ((t = trova_task(id)) != NULL) {atomic_store(&t->colpito, true);}
+   pthread_mutex_unlock(&pool.lock_slot);
+}
+
+//barriera di fine manche: cambio l'epoca (nessun flag da scrivere task per task), sveglio in blocco
+//chi dorme (thread per-entità, worker, produttori fermi su coda piena) e aspetto che l'ultimo task sia stato liberato.
+//Dopo il motore è fermo: nessun passo in corso e nessuno che possa ancora mandare messaggi
+void barriera_fine_manche() {
+   int vivi;
+   atomic_fetch_add(&pool.epoca, 1);
+   futex_wake(&pool.epoca, INT_MAX);
+   atomic_fetch_add(&pool.lavoro, 1);
+   futex_wake(&pool.lavoro, INT_MAX);
+   //anche chi aspetta una cella libera: la coda è piena e io non la sto svuotando
+   atomic_fetch_add(&coda.liberate, 1);
+   futex_wake(&coda.liberate, INT_MAX);
+   while ((vivi = atomic_load(&pool.vivi)) > 0) {futex_wait(&pool.vivi, vivi, 1000000L);}
+}
+
+//un passo dell'entità: stesso lavoro di un giro del loop del vecchio thread
+long passo_task(struct task* t) {
+   switch (t->tipo) {
+      case FROG_ID: return passo_frog(t);
+      case CROC_ID:
+      case EV_CROC_ID: return passo_croc(t);
+      case PLANT_ID: return passo_plant(t);
+      case BULL_ID:
+      case BULL_PL_ID: return passo_bullet(t);
+      case FCROC_ID: return passo_croc_creator(t);
+      case FPLANT_ID: return passo_plant_creator(t);
+      default: return -1;
+   }
+}
+
+//rana: legge l'input e manda lo spostamento (o un messaggio vuoto)
+long passo_frog(struct task* t) {
+   struct msg m = t->m; int input;
+   pthread_mutex_lock(&mutex_refresh);
+   input = (int)getch();
+   pthread_mutex_unlock(&mutex_refresh);
+   m.x = 0; m.y = 0;
+   switch (input) {
+      case KEY_UP: m.y = -FROG_Y; break;
+      case KEY_DOWN: m.y = FROG_Y; break;
+      case KEY_LEFT: m.x = -FROG_X; break;
+      case KEY_RIGHT: m.x = FROG_X; break;
+      case TAB: generate_thread(BULL_ID, -1, -1); break;
+      default: break;
+   }
+   send_msg(m);
+   return 2000;
+}
+
+//coccodrillo: un passo di flusso (se colpito da un proiettile rana smette di essere cattivo)
+long passo_croc(struct task* t) {
+   if (atomic_exchange(&t->colpito, false)) {
+      t->m.id = CROC_ID;
+      beep();
+   }
+   if (t->m.id == EV_CROC_ID && (rand() % IMMERSION == 0)) {
+      t->m.id = IMM_CROC_ID;
+   }
+   send_msg(t->m);
+   t->m.x += t->m.x_speed;
+   return 1000 + abs(flussi[t->flusso]);
+}
+
+//pianta: si fa vedere e ogni tanto spara; se colpita sta ferma per un po'
+long passo_plant(struct task* t) {
+   if (atomic_exchange(&t->colpito, false)) {
+      return rand() % ((PLANT_STOP_UPPER - PLANT_STOP_LOWER + 1) + PLANT_STOP_LOWER);
+   }
+   send_msg(t->m);
+   if (rand() % 5 == 3) {
+      generate_thread(BULL_PL_ID, -1, t->m.x);
+   }
+   return 1000 + PLANT_DELAY;
+}
+
+//proiettile: avanza di BULLET_SPEED righe
+long passo_bullet(struct task* t) {
+   if (t->m.y > 0 && t->m.y < DIM_Y-2) {
+      send_msg(t->m);
+   }
+   t->m.y += t->m.y_speed;
+   return BULL_SPEED_DELAY;
+}
+
+//padre dei coccodrilli: al primo passo si presenta, poi un coccodrillo al secondo su un flusso libero
+long passo_croc_creator(struct task* t) {
+   int flusso, id = CROC_ID;
+   if (t->m.id == FCROC_ID) {
+      send_msg(t->m);
+      t->m.id = CROC_ID;
+   }
+   flusso = rand() % N_FLUSSI;
+   while (flusso == t->old_flusso || flusso == t->old_flusso1) {
+      flusso = rand() % (N_FLUSSI);
+   }
+   t->old_flusso = flusso;
+   t->old_flusso1 = t->old_flusso;
+   if (rand() % EV_CROC_RATE == 0) {
+      id = EV_CROC_ID;
+   }
+   generate_thread(id, flusso, -1);
+   return CROC_DELAY + 1000;
+}
+
+//padre delle piante: si presenta, crea le piante e ha finito
+long passo_plant_creator(struct task* t) {
+   send_msg(t->m);
+   for (int i = 0; i < N_PIANTE; i++) {
+      generate_thread(PLANT_ID, -1, i);
+   }
+   return -1;
+}
+
+//--- statistiche ---
+
+void registra_frame(long us) {
+   long b = us / FRAME_BUCKET_US;
+   frame_hist[(b < N_BUCKET_FRAME) ? (b) : (N_BUCKET_FRAME - 1)]++;
+   n_frame++;
+   if (us > frame_max) {frame_max = us;}
+}
+
+//durata (us) sotto cui sta la frazione p dei frame
+long percentile_frame(double p) {
+   long soglia = (long)(p * n_frame), somma = 0;
+   for (int i = 0; i < N_BUCKET_FRAME; i++) {
+      somma += frame_hist[i];
+      if (somma > soglia) {return (long)(i + 1) * FRAME_BUCKET_US;}
+   }
+   return frame_max;
+}
+
+//entità che possono ancora mandare messaggi (task non ancora liberati)
+int entita_vive() {
+   return atomic_load(&pool.vivi);
+}
+
+void stampa_statistiche() {
+   fprintf(stderr, "modalità: %s", modalita_pool ? "pool" : "pthread");
+   if (modalita_pool) {fprintf(stderr, " (%d worker)", n_worker);}
+   fprintf(stderr, "\nthread: creati=%ld picco=%d\n", atomic_load(&thread_creati), atomic_load(&picco_thread));
+   fprintf(stderr, "task: creati=%ld picco=%d\n", atomic_load(&task_creati), atomic_load(&picco_task));
+   fprintf(stderr, "frame: %ld  p50=%ldus p99=%ldus p99.9=%ldus max=%ldus\n", n_frame,
+           percentile_frame(0.5), percentile_frame(0.99), percentile_frame(0.999), frame_max);
+   if (n_fine_manche > 0) {
+      fprintf(stderr, "fine manche: %ld  quiete media=%ldus max=%ldus  entità ancora vive dopo kill_all (max)=%d\n",
+              n_fine_manche, quiete_tot_us / n_fine_manche, quiete_max_us, rimasti_max);
+   }
+}
+
 //funzione che controlla la logica del gioco
 void game_polling() {
 
@@ -1443,3 +1808,97 @@ void game_polling() {
    //loop di gioco
    run(running, manche, start, vite, score);
  }
+
+//--- benchmark della coda (--bench=coda): niente ncurses ---
+
+#define BENCH_MSG 400000 //messaggi totali per misura, divisi tra i produttori
+
+//vecchio schema di riferimento: buffer + sem_liberi/sem_occupati + mutex
+struct msg* bench_buffer;
+int bench_cap, bench_leggi, bench_scrivi;
+sem_t bench_liberi, bench_occupati;
+pthread_mutex_t bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+struct bench_params {
+   int n;
+   bool trio;
+};
+
+void* bench_produttore(void* p) {
+   struct bench_params* par = (struct bench_params*)p;
+   struct msg m;
+   memset(&m, 0, sizeof(m));
+   m.id = CROC_ID;
+   m.pid = pthread_self();
+   for (int i = 0; i < par->n; i++) {
+      m.x = i;
+      if (par->trio) {
+         sem_wait(&bench_liberi);
+         pthread_mutex_lock(&bench_mutex);
+         bench_buffer[bench_scrivi] = m;
+         bench_scrivi = (bench_scrivi + 1) % bench_cap;
+         pthread_mutex_unlock(&bench_mutex);
+         sem_post(&bench_occupati);
+      }
+      else {send_msg(m);}
+   }
+   return NULL;
+}
+
+//una misura: n_prod produttori, il thread principale consuma tutto; ritorna i secondi
+double bench_run(int n_prod, bool trio, unsigned cap, long* piena) {
+   pthread_t tid[64]; struct bench_params par; struct timespec t0, t1; long somma = 0;
+   par.n = BENCH_MSG / n_prod;
+   par.trio = trio;
+   if (trio) {
+      bench_cap = cap;
+      bench_buffer = malloc(sizeof(struct msg) * cap);
+      bench_leggi = bench_scrivi = 0;
+      sem_init(&bench_liberi, 0, cap);
+      sem_init(&bench_occupati, 0, 0);
+   }
+   else {
+      free(coda.celle);
+      init_coda(cap);
+      atomic_store(&coda.piena, 0);
+   }
+   clock_gettime(CLOCK_MONOTONIC, &t0);
+   for (int i = 0; i < n_prod; i++) {pthread_create(&tid[i], NULL, &bench_produttore, &par);}
+   for (long k = 0; k < (long)par.n * n_prod; k++) {
+      struct msg m;
+      if (trio) {
+         sem_wait(&bench_occupati);
+         m = bench_buffer[bench_leggi];
+         bench_leggi = (bench_leggi + 1) % bench_cap;
+         sem_post(&bench_liberi);
+      }
+      else {m = receive_msg();}
+      somma += m.x;
+   }
+   for (int i = 0; i < n_prod; i++) {pthread_join(tid[i], NULL);}
+   clock_gettime(CLOCK_MONOTONIC, &t1);
+   //ogni produttore invia 0..n-1: la somma verifica che nessun messaggio sia perso o doppio
+   if (somma != (long)n_prod * par.n * (par.n - 1) / 2) {fprintf(stderr, "bench: somma errata\n");}
+   *piena = trio ? 0 : atomic_load(&coda.piena);
+   if (trio) {
+      sem_destroy(&bench_liberi);
+      sem_destroy(&bench_occupati);
+      free(bench_buffer);
+   }
+   return (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+//confronto a 1, 8 e 64 produttori: vecchio schema a DIM_BUFFER, coda lock-free a DIM_BUFFER e a capacita_coda
+int bench_coda() {
+   int prod[3] = {1, 8, 64}; long piena;
+   printf("coda: %d messaggi per misura (%zu byte)\n", BENCH_MSG, sizeof(struct msg));
+   for (int i = 0; i < 3; i++) {
+      double t_trio = bench_run(prod[i], true, DIM_BUFFER, &piena);
+      printf("  produttori=%2d  semafori+mutex cap=%-4d %6.2f Mmsg/s\n", prod[i], DIM_BUFFER, BENCH_MSG / t_trio / 1e6);
+      double t_lf = bench_run(prod[i], false, DIM_BUFFER, &piena);
+      printf("  produttori=%2d  lock-free      cap=%-4u %6.2f Mmsg/s  coda piena=%ld\n", prod[i], coda.cap, BENCH_MSG / t_lf / 1e6, piena);
+      t_lf = bench_run(prod[i], false, capacita_coda, &piena);
+      printf("  produttori=%2d  lock-free      cap=%-4u %6.2f Mmsg/s  coda piena=%ld\n", prod[i], coda.cap, BENCH_MSG / t_lf / 1e6, piena);
+   }
+   return 0;
+}